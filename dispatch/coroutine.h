@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2019 Apple Inc. All rights reserved.
+ *
+ * @APPLE_APACHE_LICENSE_HEADER_START@
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @APPLE_APACHE_LICENSE_HEADER_END@
+ */
+
+#ifndef __DISPATCH_COROUTINE__
+#define __DISPATCH_COROUTINE__
+
+#include <dispatch/dispatch.h>
+
+/*!
+ * @header
+ * C++20 awaitables for dispatch events.
+ *
+ * Awaiting one of these types suspends the calling coroutine and resumes it
+ * from the function callout of the corresponding dispatch event, on the queue
+ * passed to the awaitable. The coroutine frame is the context of the callout,
+ * so awaiting doesn't allocate anything besides the dispatch continuation
+ * the equivalent dispatch_*_f() call would allocate.
+ *
+ * <code>
+ *     task handle(dispatch_queue_t q, dispatch_fd_t fd) {
+ *         co_await dispatch::resume_on(q);
+ *         auto [data, error] = co_await dispatch::read_fd(fd, SIZE_MAX, q);
+ *         ...
+ *     }
+ * </code>
+ *
+ * The awaitables for dispatch I/O use the function-based I/O SPI, and are
+ * only available when <dispatch/private.h> is included before this header.
+ *
+ * The awaitables don't retain the objects they are given, which must stay
+ * valid until the coroutine is resumed.
+ */
+
+#if defined(__cplusplus) && __cplusplus >= 202002L && \
+		__has_include(<coroutine>)
+#include <coroutine>
+
+DISPATCH_ASSUME_NONNULL_BEGIN
+
+namespace dispatch {
+
+namespace __detail {
+
+inline void
+__resume(void *_Nullable frame) noexcept
+{
+	std::coroutine_handle<>::from_address(frame).resume();
+}
+
+// Keeps a reference on a data object handed to an I/O handler, which only
+// lends it for the duration of the callout
+inline void
+__data_append(dispatch_data_t _Nullable &dst, dispatch_data_t _Nullable data)
+		noexcept
+{
+	if (!data || data == dispatch_data_empty) return;
+	if (!dst) {
+#if !OS_OBJECT_USE_OBJC_RETAIN_RELEASE
+		dispatch_retain(data);
+#endif
+		dst = data;
+		return;
+	}
+	dispatch_data_t concat = dispatch_data_create_concat(dst, data);
+#if !OS_OBJECT_USE_OBJC_RETAIN_RELEASE
+	dispatch_release(dst);
+#endif
+	dst = concat;
+}
+
+} // namespace __detail
+
+/*!
+ * @class dispatch::resume_on
+ * Resumes the awaiting coroutine asynchronously on a queue, as if with
+ * dispatch_async_f().
+ */
+struct resume_on {
+	dispatch_queue_t queue;
+
+	explicit resume_on(dispatch_queue_t q) noexcept : queue(q) {}
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> h) const noexcept {
+		dispatch_async_f(queue, h.address(), __detail::__resume);
+	}
+	void await_resume() const noexcept {}
+};
+
+/*!
+ * @class dispatch::resume_after
+ * Resumes the awaiting coroutine on a queue at a given time, as if with
+ * dispatch_after_f().
+ */
+struct resume_after {
+	dispatch_time_t when;
+	dispatch_queue_t queue;
+
+	resume_after(dispatch_time_t t, dispatch_queue_t q) noexcept
+			: when(t), queue(q) {}
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> h) const noexcept {
+		dispatch_after_f(when, queue, h.address(), __detail::__resume);
+	}
+	void await_resume() const noexcept {}
+};
+
+/*!
+ * @class dispatch::group_notify
+ * Resumes the awaiting coroutine on a queue once all the work associated with
+ * a group has completed, as if with dispatch_group_notify_f().
+ */
+struct group_notify {
+	dispatch_group_t group;
+	dispatch_queue_t queue;
+
+	group_notify(dispatch_group_t g, dispatch_queue_t q) noexcept
+			: group(g), queue(q) {}
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> h) const noexcept {
+		dispatch_group_notify_f(group, queue, h.address(),
+				__detail::__resume);
+	}
+	void await_resume() const noexcept {}
+};
+
+#ifdef __DISPATCH_IO_PRIVATE__
+/*!
+ * @struct dispatch::io_result
+ * Result of the dispatch I/O awaitables.
+ *
+ * @field data
+ * For reads, the data read, or NULL if nothing was. For writes, the data that
+ * couldn't be written, or NULL. The caller owns a reference on it, and must
+ * release it with dispatch_release() unless ARC manages dispatch objects.
+ *
+ * @field error
+ * An errno condition for the operation, or zero if it was successful.
+ */
+struct io_result {
+	dispatch_data_t _Nullable data;
+	int error;
+};
+
+/*!
+ * @class dispatch::read_fd
+ * Reads from a file descriptor, as if with dispatch_read_f(), and resumes the
+ * awaiting coroutine on a queue with the result.
+ */
+class read_fd {
+	dispatch_fd_t __fd;
+	size_t __length;
+	dispatch_queue_t __queue;
+	void *_Nullable __frame = nullptr;
+	io_result __result = { nullptr, 0 };
+
+	static void __complete(void *_Nullable ctxt, dispatch_data_t data,
+			int error) noexcept {
+		read_fd *self = static_cast<read_fd *>(ctxt);
+		__detail::__data_append(self->__result.data, data);
+		self->__result.error = error;
+		__detail::__resume(self->__frame);
+	}
+
+public:
+	read_fd(dispatch_fd_t fd, size_t length, dispatch_queue_t q) noexcept
+			: __fd(fd), __length(length), __queue(q) {}
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> h) noexcept {
+		__frame = h.address();
+		dispatch_read_f(__fd, __length, __queue, this, __complete);
+	}
+	io_result await_resume() const noexcept { return __result; }
+};
+
+/*!
+ * @class dispatch::write_fd
+ * Writes to a file descriptor, as if with dispatch_write_f(), and resumes the
+ * awaiting coroutine on a queue with the result.
+ */
+class write_fd {
+	dispatch_fd_t __fd;
+	dispatch_data_t __data;
+	dispatch_queue_t __queue;
+	void *_Nullable __frame = nullptr;
+	io_result __result = { nullptr, 0 };
+
+	static void __complete(void *_Nullable ctxt,
+			dispatch_data_t _Nullable data, int error) noexcept {
+		write_fd *self = static_cast<write_fd *>(ctxt);
+		__detail::__data_append(self->__result.data, data);
+		self->__result.error = error;
+		__detail::__resume(self->__frame);
+	}
+
+public:
+	write_fd(dispatch_fd_t fd, dispatch_data_t data,
+			dispatch_queue_t q) noexcept
+			: __fd(fd), __data(data), __queue(q) {}
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> h) noexcept {
+		__frame = h.address();
+		dispatch_write_f(__fd, __data, __queue, this, __complete);
+	}
+	io_result await_resume() const noexcept { return __result; }
+};
+
+/*!
+ * @class dispatch::io_read
+ * Reads from a dispatch I/O channel, as if with dispatch_io_read_f(), and
+ * resumes the awaiting coroutine on a queue once the operation is done, with
+ * all the data that was read.
+ */
+class io_read {
+	dispatch_io_t __channel;
+	off_t __offset;
+	size_t __length;
+	dispatch_queue_t __queue;
+	void *_Nullable __frame = nullptr;
+	io_result __result = { nullptr, 0 };
+
+	static void __handler(void *_Nullable ctxt, bool done,
+			dispatch_data_t _Nullable data, int error) noexcept {
+		io_read *self = static_cast<io_read *>(ctxt);
+		__detail::__data_append(self->__result.data, data);
+		if (done) {
+			self->__result.error = error;
+			__detail::__resume(self->__frame);
+		}
+	}
+
+public:
+	io_read(dispatch_io_t channel, off_t offset, size_t length,
+			dispatch_queue_t q) noexcept
+			: __channel(channel), __offset(offset), __length(length),
+			__queue(q) {}
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> h) noexcept {
+		__frame = h.address();
+		dispatch_io_read_f(__channel, __offset, __length, __queue, this,
+				__handler);
+	}
+	io_result await_resume() const noexcept { return __result; }
+};
+
+/*!
+ * @class dispatch::io_write
+ * Writes to a dispatch I/O channel, as if with dispatch_io_write_f(), and
+ * resumes the awaiting coroutine on a queue once the operation is done.
+ */
+class io_write {
+	dispatch_io_t __channel;
+	off_t __offset;
+	dispatch_data_t __data;
+	dispatch_queue_t __queue;
+	void *_Nullable __frame = nullptr;
+	io_result __result = { nullptr, 0 };
+
+	static void __handler(void *_Nullable ctxt, bool done,
+			dispatch_data_t _Nullable data, int error) noexcept {
+		io_write *self = static_cast<io_write *>(ctxt);
+		if (done) {
+			__detail::__data_append(self->__result.data, data);
+			self->__result.error = error;
+			__detail::__resume(self->__frame);
+		}
+	}
+
+public:
+	io_write(dispatch_io_t channel, off_t offset, dispatch_data_t data,
+			dispatch_queue_t q) noexcept
+			: __channel(channel), __offset(offset), __data(data), __queue(q) {}
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> h) noexcept {
+		__frame = h.address();
+		dispatch_io_write_f(__channel, __offset, __data, __queue, this,
+				__handler);
+	}
+	io_result await_resume() const noexcept { return __result; }
+};
+#endif // __DISPATCH_IO_PRIVATE__
+
+} // namespace dispatch
+
+DISPATCH_ASSUME_NONNULL_END
+
+#endif // __cplusplus >= 202002L
+
+#endif // __DISPATCH_COROUTINE__
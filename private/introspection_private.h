@@ -575,6 +575,12 @@ typedef void (*dispatch_introspection_hook_queue_item_complete_t)(
  *
  * `ptr` is set to dispatch_queue_t which is handed off to the next thread.
  * `value` is 0.
+ *
+ * @const dispatch_introspection_runtime_event_deadline_expired
+ * A work item submitted with dispatch_async_with_deadline_f() was dropped
+ * because its deadline had passed when it was dequeued.
+ * `ptr` is the queue the item was dequeued from.
+ * `value` is the deadline of the item.
  */
 #ifndef __DISPATCH_BUILDING_DISPATCH__
 enum dispatch_introspection_runtime_event {
@@ -587,6 +593,8 @@ enum dispatch_introspection_runtime_event {
 	dispatch_introspection_runtime_event_async_sync_handoff = 11,
 	dispatch_introspection_runtime_event_sync_sync_handoff = 12,
 	dispatch_introspection_runtime_event_sync_async_handoff = 13,
+
+	dispatch_introspection_runtime_event_deadline_expired = 20,
 };
 #endif
 
@@ -768,6 +776,213 @@ extern dispatch_introspection_queue_item_s
 dispatch_introspection_queue_item_get_info(dispatch_queue_t queue,
 		dispatch_continuation_t item);
 
+/*!
+ * @typedef dispatch_introspection_stats_s
+ *
+ * @abstract
+ * Scheduler counters aggregated over all threads of the process.
+ *
+ * @field root_queue_items_enqueued
+ * Number of items enqueued on each global root queue, indexed by QoS bucket
+ * (from maintenance to user-interactive) for the non-overcommit root queues,
+ * followed by the overcommit root queues in the same order.
+ *
+ * @field root_queue_items_drained
+ * Number of items drained from each global root queue, using the same indexing
+ * as root_queue_items_enqueued.
+ *
+ * @field threads_spawned
+ * Number of worker threads created by the thread pool.
+ *
+ * @field threads_parked
+ * Number of times a worker thread ran out of work and parked.
+ *
+ * @field threads_reaped
+ * Number of worker threads that exited after staying idle.
+ *
+ * @field contended_waits
+ * Number of times a worker had to wait for a contended root queue.
+ *
+ * @field continuation_cache_hits
+ * Number of continuations allocated from the per-thread cache.
+ *
+ * @field continuation_cache_misses
+ * Number of continuations allocated from the heap.
+ *
+ * @field timers_fired
+ * Number of timer sources that fired.
+ *
+ * @field event_loop_wakeups
+ * Number of times the event loop returned from waiting for events.
+ *
+ * @field object_slab_hits
+ * Number of dispatch objects allocated from the per-thread slab cache.
+ *
+ * @field object_slab_misses
+ * Number of times a per-thread slab cache had to be refilled, either from the
+ * shared depot or from a new slab.
+ *
+ * @field object_slab_bytes_in_use
+ * Bytes of slab memory holding live dispatch objects, rounded up to their size
+ * class.
+ *
+ * @field object_slab_bytes_reserved
+ * Bytes of slab memory mapped so far. The difference with
+ * object_slab_bytes_in_use is held by the caches or not yet carved, and is
+ * never returned to the system.
+ */
+#define DISPATCH_INTROSPECTION_STATS_ROOT_QUEUE_COUNT 12
+
+typedef struct dispatch_introspection_stats_s {
+	unsigned long long root_queue_items_enqueued[
+			DISPATCH_INTROSPECTION_STATS_ROOT_QUEUE_COUNT];
+	unsigned long long root_queue_items_drained[
+			DISPATCH_INTROSPECTION_STATS_ROOT_QUEUE_COUNT];
+	unsigned long long threads_spawned;
+	unsigned long long threads_parked;
+	unsigned long long threads_reaped;
+	unsigned long long contended_waits;
+	unsigned long long continuation_cache_hits;
+	unsigned long long continuation_cache_misses;
+	unsigned long long timers_fired;
+	unsigned long long event_loop_wakeups;
+	unsigned long long object_slab_hits;
+	unsigned long long object_slab_misses;
+	unsigned long long object_slab_bytes_in_use;
+	unsigned long long object_slab_bytes_reserved;
+} dispatch_introspection_stats_s;
+typedef dispatch_introspection_stats_s *dispatch_introspection_stats_t;
+
+/*!
+ * @function dispatch_introspection_copy_stats
+ *
+ * @abstract
+ * Copy a snapshot of the scheduler counters.
+ *
+ * @discussion
+ * Unlike the rest of this SPI, this function is available in every variant of
+ * the library. Counters are maintained per thread and summed when this
+ * function is called, so that their cost on the hot paths is a single
+ * uncontended increment. Configurations without support for these counters
+ * report zeroes.
+ *
+ * @param stats
+ * Pointer to the structure to fill.
+ *
+ * @param size
+ * Size of the structure pointed to by stats, at most that many bytes are
+ * written.
+ *
+ * @result
+ * The number of bytes written.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT size_t
+dispatch_introspection_copy_stats(dispatch_introspection_stats_t stats,
+		size_t size);
+
+/*!
+ * @typedef dispatch_introspection_queue_latency_s
+ *
+ * @abstract
+ * Latency histograms of a queue created with
+ * dispatch_queue_attr_make_with_latency_tracking().
+ *
+ * @discussion
+ * Durations are expressed in nanoseconds and bucketed in log-linear
+ * histograms: a duration of d nanoseconds is counted in bucket d when d is
+ * less than 2^S (where S is DISPATCH_INTROSPECTION_LATENCY_SUB_BUCKET_SHIFT),
+ * and otherwise in bucket ((e - S + 1) << S) + ((d >> (e - S)) & (2^S - 1))
+ * where e is the index of the most significant bit set in d. Durations that
+ * don't fit in the histogram are counted in the last bucket.
+ *
+ * @field wait_total
+ * Sum of the durations work items waited in the queue.
+ *
+ * @field run_total
+ * Sum of the durations work items ran for.
+ *
+ * @field wait
+ * Histogram of the durations between the submission of work items and the
+ * moment they started running.
+ *
+ * @field run
+ * Histogram of the durations work items ran for.
+ */
+#define DISPATCH_INTROSPECTION_LATENCY_SUB_BUCKET_SHIFT 3
+#define DISPATCH_INTROSPECTION_LATENCY_BUCKET_COUNT 336
+
+typedef struct dispatch_introspection_queue_latency_s {
+	unsigned long long wait_total;
+	unsigned long long run_total;
+	unsigned long long wait[DISPATCH_INTROSPECTION_LATENCY_BUCKET_COUNT];
+	unsigned long long run[DISPATCH_INTROSPECTION_LATENCY_BUCKET_COUNT];
+} dispatch_introspection_queue_latency_s;
+typedef dispatch_introspection_queue_latency_s
+		*dispatch_introspection_queue_latency_t;
+
+/*!
+ * @function dispatch_introspection_queue_copy_latency
+ *
+ * @abstract
+ * Copy a snapshot of the latency histograms of a queue.
+ *
+ * @discussion
+ * Like dispatch_introspection_copy_stats(), this function is available in
+ * every variant of the library.
+ *
+ * @param queue
+ * The queue to inspect.
+ *
+ * @param latency
+ * Pointer to the structure to fill.
+ *
+ * @param size
+ * Size of the structure pointed to by latency, at most that many bytes are
+ * written.
+ *
+ * @result
+ * The number of bytes written, which is 0 if the queue wasn't created with
+ * dispatch_queue_attr_make_with_latency_tracking() or if latency tracking is
+ * not supported.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT size_t
+dispatch_introspection_queue_copy_latency(dispatch_queue_t queue,
+		dispatch_introspection_queue_latency_t latency, size_t size);
+
+/*!
+ * @function dispatch_introspection_trace_buffer_dump
+ *
+ * @abstract
+ * Write the content of the per-thread trace buffers to a file descriptor.
+ *
+ * @discussion
+ * When the LIBDISPATCH_TRACE_BUFFER environment variable is set, every thread
+ * records queue pushes and pops, client callouts and runtime events into a
+ * small ring buffer. This function writes the most recent of these events
+ * in a binary format that tools/dispatch_trace_convert.py converts to a
+ * Chrome trace.
+ *
+ * This function is async-signal-safe. Setting
+ * LIBDISPATCH_TRACE_BUFFER_SIGNAL to a signal number makes libdispatch dump
+ * the buffers to LIBDISPATCH_TRACE_BUFFER_PATH (by default
+ * /tmp/libdispatch.<pid>.trace) when that signal is delivered.
+ *
+ * Like dispatch_introspection_copy_stats(), this function is available in
+ * every variant of the library.
+ *
+ * @param fd
+ * The file descriptor to write to.
+ *
+ * @result
+ * 0 on success, ENOTSUP if trace buffers are not supported or not enabled,
+ * or the error returned by write(2).
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT int
+dispatch_introspection_trace_buffer_dump(int fd);
+
 /*!
  * @function dispatch_introspection_hooks_install
  *
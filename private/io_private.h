@@ -322,6 +322,99 @@ dispatch_io_read_f(dispatch_io_t channel,
 	void *_Nullable context,
 	dispatch_io_handler_function_t io_handler);
 
+/*!
+ * @function dispatch_io_read_into
+ * Schedule a read operation for asynchronous execution on the specified I/O
+ * channel, reading directly into the memory described by a caller-supplied
+ * destination data object. The I/O handler is enqueued one or more times
+ * depending on the general load of the system and the policy specified on the
+ * I/O channel.
+ *
+ * The regions of the destination data object are filled in order with
+ * readv(2) (resp. preadv(2) for DISPATCH_IO_RANDOM channels), and no
+ * intermediate buffers are allocated by the system. The data objects passed to
+ * the I/O handler are subranges of the destination that describe the data most
+ * recently read, in the order in which it was read.
+ *
+ * The memory backing the destination must be writable and must not be accessed
+ * by the application until the I/O handler has been enqueued with the done
+ * flag set. Destinations should therefore be created with
+ * dispatch_data_create() and a destructor other than
+ * DISPATCH_DATA_DESTRUCTOR_DEFAULT (which would copy the buffer), possibly
+ * concatenated from several such buffers to describe a scatter list.
+ *
+ * The length of the read operation is the size of the destination. In all
+ * other respects the operation behaves like one scheduled with
+ * dispatch_io_read(), except that channels in datagram mode (see
+ * dispatch_io_set_datagram_batch()) don't support it and fail the operation
+ * with EINVAL.
+ *
+ * @param channel	The dispatch I/O channel from which to read the data.
+ * @param offset	The offset relative to the channel position from which
+ *			to start reading (only for DISPATCH_IO_RANDOM).
+ * @param destination	The data object describing the memory to read into.
+ *			The data object will be retained by the system until
+ *			the read operation is complete.
+ * @param queue		The dispatch queue to which the I/O handler should be
+ *			submitted.
+ * @param io_handler	The I/O handler to enqueue when data is ready to be
+ *			delivered.
+ *	param done	A flag indicating whether the operation is complete.
+ *	param data	A subrange of the destination with the data most
+ *			recently read from the I/O channel as part of this
+ *			read operation, or NULL.
+ *	param error	An errno condition for the read operation or zero if
+ *			the read was successful.
+ */
+#ifdef __BLOCKS__
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL3 DISPATCH_NONNULL4
+DISPATCH_NONNULL5 DISPATCH_NOTHROW
+void
+dispatch_io_read_into(dispatch_io_t channel,
+	off_t offset,
+	dispatch_data_t destination,
+	dispatch_queue_t queue,
+	dispatch_io_handler_t io_handler);
+#endif /* __BLOCKS__ */
+
+/*!
+ * @function dispatch_io_read_into_f
+ * Schedule a read operation for asynchronous execution on the specified I/O
+ * channel, reading directly into the memory described by a caller-supplied
+ * destination data object.
+ *
+ * See dispatch_io_read_into() for details.
+ *
+ * @param channel	The dispatch I/O channel from which to read the data.
+ * @param offset	The offset relative to the channel position from which
+ *			to start reading (only for DISPATCH_IO_RANDOM).
+ * @param destination	The data object describing the memory to read into.
+ * @param queue		The dispatch queue to which the I/O handler should be
+ *			submitted.
+ * @param context	The application-defined context parameter to pass to
+ *			the handler function.
+ * @param io_handler	The I/O handler to enqueue when data is ready to be
+ *			delivered.
+ *	param context	Application-defined context parameter.
+ *	param done	A flag indicating whether the operation is complete.
+ *	param data	A subrange of the destination with the data most
+ *			recently read from the I/O channel as part of this
+ *			read operation, or NULL.
+ *	param error	An errno condition for the read operation or zero if
+ *			the read was successful.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL3 DISPATCH_NONNULL4
+DISPATCH_NONNULL6 DISPATCH_NOTHROW
+void
+dispatch_io_read_into_f(dispatch_io_t channel,
+	off_t offset,
+	dispatch_data_t destination,
+	dispatch_queue_t queue,
+	void *_Nullable context,
+	dispatch_io_handler_function_t io_handler);
+
 /*!
  * @function dispatch_io_write_f
  * Schedule a write operation for asynchronous execution on the specified I/O
@@ -409,6 +502,47 @@ dispatch_io_barrier_f(dispatch_io_t channel,
 	void *_Nullable context,
 	dispatch_function_t barrier);
 
+/*!
+ * @function dispatch_io_set_datagram_batch
+ * Put a stream I/O channel associated with a datagram (or sequenced packet)
+ * socket in datagram mode, in which messages are exchanged in batches with
+ * as few system calls as possible.
+ *
+ * In datagram mode, each read performed on the channel receives up to the
+ * specified number of messages with a single call to recvmmsg(2). The messages
+ * are received into a buffer shared by the messages of several batches, and
+ * the data object passed to the I/O handler of a read operation is composed of
+ * one region per message, in the order in which they were received. These can
+ * be visited with dispatch_data_apply(). Empty messages are not delivered, and
+ * messages larger than the specified maximum size are truncated.
+ *
+ * Conversely, each region of the data object passed to a write operation is
+ * sent as one message, with up to the specified number of messages sent by a
+ * single call to sendmmsg(2).
+ *
+ * The low-water and high-water marks and the interval of the channel apply to
+ * the total size of the messages in datagram mode. Setting a low-water mark of
+ * 1 delivers every batch as soon as it has been received. The length of a
+ * read operation is only an estimate of the amount of data to read, and the
+ * operation completes when that amount has been reached or exceeded.
+ *
+ * This setting only affects operations scheduled after it has been applied,
+ * and is ignored by DISPATCH_IO_RANDOM channels.
+ *
+ * @param channel	The dispatch I/O channel on which to set the policy.
+ * @param max_messages	The maximum number of messages per batch, or zero to
+ *			leave datagram mode. This is capped to an internal
+ *			limit.
+ * @param max_size	The maximum size of a received message. This is capped
+ *			to an internal limit.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+void
+dispatch_io_set_datagram_batch(dispatch_io_t channel,
+	size_t max_messages,
+	size_t max_size);
+
 __END_DECLS
 
 DISPATCH_ASSUME_NONNULL_END
@@ -258,6 +258,33 @@ DISPATCH_EXPORT DISPATCH_NOTHROW
 void
 _dispatch_poll_for_events_4launchd(void);
 
+/*!
+ * @function dispatch_group_create_sharded
+ *
+ * @abstract
+ * Creates a new group for massive fan-in.
+ *
+ * @discussion
+ * The returned group behaves exactly like one returned by
+ * dispatch_group_create(), but counts calls to dispatch_group_enter() and
+ * dispatch_group_leave() in per-CPU counters so that many threads entering
+ * and leaving it concurrently don't contend on a single cacheline. Only the
+ * transitions of these counters to and from zero update the state that
+ * dispatch_group_wait() and dispatch_group_notify() observe.
+ *
+ * This makes entering and leaving the group slightly more expensive when it
+ * is uncontended, and the group larger: it should be reserved to groups that
+ * are joined by many threads at once.
+ *
+ * @result
+ * The newly created group, or NULL on failure.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_MALLOC DISPATCH_RETURNS_RETAINED DISPATCH_WARN_RESULT
+DISPATCH_NOTHROW
+dispatch_group_t
+dispatch_group_create_sharded(void);
+
 __END_DECLS
 
 DISPATCH_ASSUME_NONNULL_END
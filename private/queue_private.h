@@ -234,6 +234,37 @@ dispatch_queue_attr_t
 dispatch_queue_attr_make_with_overcommit(dispatch_queue_attr_t _Nullable attr,
 		bool overcommit);
 
+/*!
+ * @function dispatch_queue_attr_make_with_latency_tracking
+ *
+ * @discussion
+ * Returns a dispatch queue attribute value that makes the queue record, for
+ * every work item submitted asynchronously to it, how long the item waited in
+ * the queue before it started running and how long it ran.
+ *
+ * These durations are accumulated in per-queue histograms which can be read
+ * with dispatch_introspection_queue_copy_latency(). Tracking latency costs a
+ * few clock reads per work item and is meant to diagnose queues suffering from
+ * head-of-line blocking.
+ *
+ * This attribute is ignored on platforms where latency tracking is not
+ * supported.
+ *
+ * @param attr
+ * A queue attribute value to be combined with the latency tracking attribute,
+ * or NULL.
+ *
+ * @return
+ * Returns an attribute value which may be provided to dispatch_queue_create().
+ * This new value combines the attributes specified by the 'attr' parameter and
+ * the latency tracking attribute.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_WARN_RESULT DISPATCH_PURE DISPATCH_NOTHROW
+dispatch_queue_attr_t
+dispatch_queue_attr_make_with_latency_tracking(
+		dispatch_queue_attr_t _Nullable attr);
+
 /*!
  * @typedef dispatch_queue_priority_t
  *
@@ -474,6 +505,164 @@ void
 dispatch_async_enforce_qos_class_f(dispatch_queue_t queue,
 		void *_Nullable context, dispatch_function_t work);
 
+/*!
+ * @function dispatch_async_with_deadline_f
+ *
+ * @abstract
+ * Submits a function for asynchronous execution on a dispatch queue, to be
+ * dropped if it can't start before a deadline.
+ *
+ * @discussion
+ * The function is invoked like with dispatch_async_f(), unless the deadline
+ * has passed by the time it is dequeued, in which case the `expired` function
+ * is called with the same context instead, or nothing at all if `expired` is
+ * NULL. This lets a system under overload shed stale work cheaply rather than
+ * executing it late.
+ *
+ * While `work` runs, the deadline is the current deadline of the thread (see
+ * dispatch_get_current_deadline()), and any dispatch_async_with_deadline_f()
+ * call it makes is subject to the earliest of the deadline it passes and the
+ * current deadline.
+ *
+ * Deadlines are not enforced on platforms with 32-bit pointers, where this
+ * behaves like dispatch_async_f().
+ *
+ * @param queue
+ * The target dispatch queue to which the function is submitted.
+ * The system will hold a reference on the target queue until the function
+ * has returned.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param deadline
+ * The time after which the function should no longer be invoked.
+ * Passing DISPATCH_TIME_FOREVER only applies the current deadline if any.
+ *
+ * @param context
+ * The application-defined context parameter to pass to the functions.
+ *
+ * @param work
+ * The application-defined function to invoke on the target queue.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param expired
+ * An optional application-defined function to invoke on the target queue
+ * instead of `work` when the deadline has passed.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL4 DISPATCH_NOTHROW
+void
+dispatch_async_with_deadline_f(dispatch_queue_t queue,
+		dispatch_time_t deadline, void *_Nullable context,
+		dispatch_function_t work, dispatch_function_t _Nullable expired);
+
+/*!
+ * @function dispatch_get_current_deadline
+ *
+ * @abstract
+ * Returns the deadline of the work item running on the current thread.
+ *
+ * @discussion
+ * Work items submitted with dispatch_async_with_deadline_f() run with their
+ * deadline as the current deadline of the thread, this allows nested work
+ * to either check how much time it has left, or to pass the deadline along.
+ *
+ * @result
+ * The deadline of the current work item, or DISPATCH_TIME_FOREVER if it has
+ * none.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_WARN_RESULT DISPATCH_NOTHROW
+dispatch_time_t
+dispatch_get_current_deadline(void);
+
+/*!
+ * @functiongroup Dispatch Strand SPI
+ *
+ * A strand runs the work items submitted to it one at a time, in submission
+ * order, on its target queue, like a serial queue targeting that queue would.
+ *
+ * Strands are much smaller than queues and cheaper to submit to, which makes
+ * them suitable for serializing work per entity (session, actor, ...) when
+ * there are millions of them. In exchange, they have none of the queue
+ * features besides serialization: strands can't be suspended, have no width,
+ * label or queue-specific storage, and don't support dispatch_sync() or
+ * barriers. Work items submitted to a strand see its target queue as the
+ * current queue.
+ *
+ * The target queue of a strand can't be changed after it is created.
+ */
+
+/*!
+ * @typedef dispatch_strand_t
+ * A lightweight serialization context for work items.
+ */
+DISPATCH_DECL(dispatch_strand);
+
+/*!
+ * @function dispatch_strand_create
+ * Creates a strand.
+ *
+ * @param target
+ * The queue on which the work items submitted to the strand are run.
+ * Passing NULL uses the default priority global concurrent queue.
+ *
+ * @result
+ * The newly created strand.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_MALLOC DISPATCH_RETURNS_RETAINED DISPATCH_WARN_RESULT
+DISPATCH_NOTHROW
+dispatch_strand_t
+dispatch_strand_create(dispatch_queue_t _Nullable target);
+
+#ifdef __BLOCKS__
+/*!
+ * @function dispatch_strand_async
+ * Submits a block for asynchronous execution on a strand.
+ *
+ * @discussion
+ * The block runs after all the work items previously submitted to the strand
+ * have returned. The strand is retained until the block has returned.
+ *
+ * @param strand
+ * The strand to which the block is submitted.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param block
+ * The block to submit.
+ * The result of passing NULL in this parameter is undefined.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+dispatch_strand_async(dispatch_strand_t strand, dispatch_block_t block);
+#endif
+
+/*!
+ * @function dispatch_strand_async_f
+ * Submits a function for asynchronous execution on a strand.
+ *
+ * @discussion
+ * See dispatch_strand_async() for details.
+ *
+ * @param strand
+ * The strand to which the function is submitted.
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param context
+ * The application-defined context parameter to pass to the function.
+ *
+ * @param work
+ * The application-defined function to invoke on the target queue of the
+ * strand.
+ * The result of passing NULL in this parameter is undefined.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NONNULL3 DISPATCH_NOTHROW
+void
+dispatch_strand_async_f(dispatch_strand_t strand, void *_Nullable context,
+		dispatch_function_t work);
+
 #ifdef __ANDROID__
 /*!
  * @function _dispatch_install_thread_detach_callback
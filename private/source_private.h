@@ -123,6 +123,35 @@ DISPATCH_SOURCE_TYPE_DECL(sock);
 API_AVAILABLE(macos(10.12), ios(10.0), tvos(10.0), watchos(3.0)) DISPATCH_LINUX_UNAVAILABLE()
 DISPATCH_SOURCE_TYPE_DECL(nw_channel);
 
+/*!
+ * @const DISPATCH_SOURCE_TYPE_DATA_VECTOR
+ * @discussion A dispatch source that accumulates the pointers passed to
+ * dispatch_source_merge_pointer() and hands them to its event handler in
+ * batches, in the order in which they were merged. The event handler retrieves
+ * them with dispatch_source_copy_pointers(), and dispatch_source_get_data()
+ * returns the number of pointers available to it.
+ * The handle is unused (pass zero for now).
+ * The mask is unused (pass zero for now).
+ */
+#define DISPATCH_SOURCE_TYPE_DATA_VECTOR (&_dispatch_source_type_data_vector)
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_SOURCE_TYPE_DECL(data_vector);
+
+/*!
+ * @const DISPATCH_SOURCE_TYPE_FD_SET
+ * @discussion A dispatch source that monitors the readiness of many file
+ * descriptors at once. File descriptors are added to the set with
+ * dispatch_source_fd_set_add() and cost a kernel poller entry each, instead of
+ * a source, a unote and a muxnote. The event handler runs once for all the file
+ * descriptors that became ready, and retrieves them with
+ * dispatch_source_copy_fd_events().
+ * The handle is unused (pass zero for now).
+ * The mask is unused (pass zero for now).
+ */
+#define DISPATCH_SOURCE_TYPE_FD_SET (&_dispatch_source_type_fd_set)
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_SOURCE_TYPE_DECL(fd_set);
+
 __END_DECLS
 
 /*!
@@ -638,6 +667,312 @@ size_t
 dispatch_source_get_extended_data(dispatch_source_t source,
 		dispatch_source_extended_data_t data, size_t size);
 
+/*!
+ * @function dispatch_source_merge_pointer
+ *
+ * @abstract
+ * Adds a pointer to the batch of a DISPATCH_SOURCE_TYPE_DATA_VECTOR source and
+ * submits its event handler block to its target queue if needed.
+ *
+ * @discussion
+ * Only the first pointer merged after the event handler latched the previous
+ * batch wakes the source up, so that high-rate producers don't contend on the
+ * state of the source. Pointers that haven't been delivered to the event
+ * handler when the source is cancelled are dropped.
+ *
+ * @param source
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param pointer
+ * The pointer to add to the batch.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+void
+dispatch_source_merge_pointer(dispatch_source_t source,
+		void *_Nullable pointer);
+
+/*!
+ * @function dispatch_source_copy_pointers
+ *
+ * @abstract
+ * Retrieves pointers from the batch of a DISPATCH_SOURCE_TYPE_DATA_VECTOR
+ * source.
+ *
+ * @discussion
+ * This function is intended to be called from within the event handler block,
+ * repeatedly until it returns 0. Pointers that the event handler doesn't
+ * retrieve are handed to it again, at the head of the next batch.
+ *
+ * @param source
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param pointers
+ * The array to fill.
+ *
+ * @param count
+ * The number of elements of the pointers array.
+ *
+ * @result
+ * The number of pointers retrieved, in the order in which they were merged.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_WARN_RESULT DISPATCH_NOTHROW
+size_t
+dispatch_source_copy_pointers(dispatch_source_t source,
+		void *_Nullable *_Nonnull pointers, size_t count);
+
+/*!
+ * @typedef dispatch_fd_set_flags_t
+ * Type of dispatch_source_fd_set flags
+ *
+ * @constant DISPATCH_FD_SET_READ
+ * The file descriptor is readable.
+ *
+ * @constant DISPATCH_FD_SET_WRITE
+ * The file descriptor is writable.
+ *
+ * @constant DISPATCH_FD_SET_EOF
+ * The peer closed its end of the file descriptor. Only reported.
+ *
+ * @constant DISPATCH_FD_SET_ERROR
+ * An error is pending on the file descriptor. Only reported.
+ */
+DISPATCH_ENUM(dispatch_fd_set_flags, uint32_t,
+	DISPATCH_FD_SET_READ = 0x1,
+	DISPATCH_FD_SET_WRITE = 0x2,
+	DISPATCH_FD_SET_EOF = 0x4,
+	DISPATCH_FD_SET_ERROR = 0x8,
+);
+
+/*!
+ * @typedef dispatch_fd_event_s
+ * A file descriptor of a DISPATCH_SOURCE_TYPE_FD_SET source that is ready,
+ * and the dispatch_fd_set_flags_t describing its readiness.
+ */
+typedef struct dispatch_fd_event_s {
+	dispatch_fd_t fd;
+	dispatch_fd_set_flags_t events;
+} dispatch_fd_event_s;
+
+/*!
+ * @function dispatch_source_fd_set_add
+ *
+ * @abstract
+ * Adds a file descriptor to a DISPATCH_SOURCE_TYPE_FD_SET source, or changes
+ * the events monitored for a file descriptor already in the set.
+ *
+ * @discussion
+ * Readiness is level-triggered: a file descriptor is reported to every
+ * invocation of the event handler until it is drained, or until its events are
+ * changed or it is removed from the set. The file descriptor must be removed
+ * from the set before it is closed.
+ *
+ * @param source
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param fd
+ * The file descriptor to monitor.
+ *
+ * @param events
+ * DISPATCH_FD_SET_READ and/or DISPATCH_FD_SET_WRITE.
+ *
+ * @result
+ * 0 on success, or the errno value describing why the file descriptor could
+ * not be monitored.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+int
+dispatch_source_fd_set_add(dispatch_source_t source, dispatch_fd_t fd,
+		dispatch_fd_set_flags_t events);
+
+/*!
+ * @function dispatch_source_fd_set_remove
+ *
+ * @abstract
+ * Removes a file descriptor from a DISPATCH_SOURCE_TYPE_FD_SET source.
+ *
+ * @param source
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param fd
+ * The file descriptor to stop monitoring.
+ *
+ * @result
+ * 0 on success, or the errno value describing the failure.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+int
+dispatch_source_fd_set_remove(dispatch_source_t source, dispatch_fd_t fd);
+
+/*!
+ * @function dispatch_source_copy_fd_events
+ *
+ * @abstract
+ * Retrieves the ready file descriptors of a DISPATCH_SOURCE_TYPE_FD_SET source.
+ *
+ * @discussion
+ * This function is intended to be called once from within the event handler
+ * block, and never blocks. Ready file descriptors that don't fit in the array
+ * are reported to the next invocation of the event handler.
+ *
+ * @param source
+ * The result of passing NULL in this parameter is undefined.
+ *
+ * @param events
+ * The array to fill.
+ *
+ * @param count
+ * The number of elements of the events array.
+ *
+ * @result
+ * The number of ready file descriptors retrieved.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_WARN_RESULT DISPATCH_NOTHROW
+size_t
+dispatch_source_copy_fd_events(dispatch_source_t source,
+		dispatch_fd_event_s *_Nonnull events, size_t count);
+
+/*!
+ * @functiongroup Dispatch Channel SPI
+ *
+ * A dispatch channel is a bounded multiple producers, single consumer queue
+ * of pointers. Producers send pointers with dispatch_channel_send(), which
+ * blocks or fails when the channel holds as many pointers as its capacity,
+ * and the consumer handler receives them in batches on the target queue of
+ * the channel.
+ *
+ * Channels are built on DISPATCH_SOURCE_TYPE_DATA_VECTOR sources: sending a
+ * pointer doesn't submit a work item, and only wakes the consumer up when it
+ * isn't already about to run.
+ */
+
+/*!
+ * @typedef dispatch_channel_t
+ * A bounded channel of pointers.
+ */
+DISPATCH_DECL(dispatch_channel);
+
+#ifdef __BLOCKS__
+/*!
+ * @typedef dispatch_channel_handler_t
+ * Prototype of dispatch channel handler blocks.
+ *
+ * @param pointers	The pointers received, in the order they were sent.
+ * @param count		The number of pointers received, at most the batch size
+ *					of the channel.
+ */
+typedef void (^dispatch_channel_handler_t)(void *_Nullable *_Nonnull pointers,
+		size_t count);
+
+/*!
+ * @function dispatch_channel_create
+ * Creates a bounded channel of pointers.
+ *
+ * @param queue
+ * The target queue of the channel, where the handler is submitted.
+ *
+ * @param capacity
+ * The maximum number of pointers sent but not received yet.
+ *
+ * @param batch_size
+ * The maximum number of pointers passed to one invocation of the handler.
+ *
+ * @param handler
+ * The handler block to submit when pointers have been sent.
+ *
+ * @result
+ * The newly created channel, or NULL if capacity or batch_size is 0 or
+ * capacity is too large.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_MALLOC DISPATCH_RETURNS_RETAINED DISPATCH_WARN_RESULT
+DISPATCH_NONNULL4 DISPATCH_NOTHROW
+dispatch_channel_t
+dispatch_channel_create(dispatch_queue_t _Nullable queue, size_t capacity,
+		size_t batch_size, dispatch_channel_handler_t handler);
+#endif
+
+/*!
+ * @typedef dispatch_channel_handler_function_t
+ * Prototype of dispatch channel handler functions.
+ *
+ * @param context	Application-defined context parameter.
+ * @param pointers	The pointers received, in the order they were sent.
+ * @param count		The number of pointers received, at most the batch size
+ *					of the channel.
+ */
+typedef void (*dispatch_channel_handler_function_t)(void *_Nullable context,
+		void *_Nullable *_Nonnull pointers, size_t count);
+
+/*!
+ * @function dispatch_channel_create_f
+ * Creates a bounded channel of pointers.
+ *
+ * See dispatch_channel_create() for details.
+ *
+ * @param context
+ * The application-defined context parameter to pass to the handler function.
+ *
+ * @param handler
+ * The handler function to submit when pointers have been sent.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_MALLOC DISPATCH_RETURNS_RETAINED DISPATCH_WARN_RESULT
+DISPATCH_NONNULL5 DISPATCH_NOTHROW
+dispatch_channel_t
+dispatch_channel_create_f(dispatch_queue_t _Nullable queue, size_t capacity,
+		size_t batch_size, void *_Nullable context,
+		dispatch_channel_handler_function_t handler);
+
+/*!
+ * @function dispatch_channel_send
+ * Sends a pointer to the consumer of a channel.
+ *
+ * @discussion
+ * If the channel is full, waits until the consumer received enough pointers
+ * or until the specified timeout. Passing DISPATCH_TIME_NOW makes this
+ * function fail immediately when the channel is full.
+ *
+ * @param channel
+ * The channel to send the pointer to.
+ *
+ * @param pointer
+ * The pointer to send.
+ *
+ * @param timeout
+ * When to give up waiting for room in the channel.
+ *
+ * @result
+ * 0 on success, ETIMEDOUT if the channel stayed full until the timeout, or
+ * ECANCELED if the channel was cancelled.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL1 DISPATCH_NOTHROW
+int
+dispatch_channel_send(dispatch_channel_t channel, void *_Nullable pointer,
+		dispatch_time_t timeout);
+
+/*!
+ * @function dispatch_channel_cancel
+ * Cancels a channel.
+ *
+ * @discussion
+ * Pointers that have been sent but not received yet are dropped, and
+ * subsequent or blocked calls to dispatch_channel_send() fail with ECANCELED.
+ * Releasing the last reference to a channel cancels it.
+ *
+ * @param channel
+ * The channel to cancel.
+ */
+API_AVAILABLE(macos(10.15), ios(13.0), tvos(13.0), watchos(6.0))
+DISPATCH_EXPORT DISPATCH_NONNULL_ALL DISPATCH_NOTHROW
+void
+dispatch_channel_cancel(dispatch_channel_t channel);
+
 __END_DECLS
 
 DISPATCH_ASSUME_NONNULL_END
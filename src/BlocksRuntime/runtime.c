@@ -28,6 +28,21 @@
 #define os_assert(_x) assert(_x)
 #endif
 
+// Heap copies of blocks are served from size-classed, per-thread free lists
+// unless the ObjC runtime may own them (its GC and malloc introspection
+// expect plain malloc blocks).
+#ifndef BLOCK_USE_POOLED_ALLOCATOR
+#if !HAVE_OBJC && !TARGET_OS_WIN32
+#define BLOCK_USE_POOLED_ALLOCATOR 1
+#else
+#define BLOCK_USE_POOLED_ALLOCATOR 0
+#endif
+#endif
+
+#if BLOCK_USE_POOLED_ALLOCATOR
+#include <pthread.h>
+#endif
+
 #if TARGET_OS_WIN32
 #define _CRT_SECURE_NO_WARNINGS 1
 #include <windows.h>
@@ -138,6 +153,204 @@ static bool latching_decr_int_now_zero(volatile int32_t *where) {
 }
 
 
+#if BLOCK_USE_POOLED_ALLOCATOR
+/***********************
+Pooled allocator
+************************/
+#pragma mark Pooled Allocator
+
+// Most block copies and byrefs are 32 to 128 bytes and are released on another
+// thread than the one which copied them (e.g. dispatch_async). Allocations up
+// to BLOCK_POOL_MAX_SIZE are rounded to a multiple of BLOCK_POOL_QUANTUM and
+// recycled through a per-thread cache for each size class. Threads whose
+// cache overflows (the ones releasing blocks) give a batch to a global depot,
+// threads whose cache is empty (the ones copying blocks) take a batch from it,
+// so that the depot lock is only taken once every BLOCK_POOL_BATCH blocks.
+//
+// Every allocation is preceded by a header recording its size class, so that
+// _Block_deallocator can find it from the pointer alone.
+
+#define BLOCK_POOL_QUANTUM      16ul
+#define BLOCK_POOL_CLASS_COUNT  8ul
+#define BLOCK_POOL_MAX_SIZE     (BLOCK_POOL_QUANTUM * BLOCK_POOL_CLASS_COUNT)
+#define BLOCK_POOL_LARGE        BLOCK_POOL_CLASS_COUNT
+#define BLOCK_POOL_CACHE_LIMIT  64u     // per size class and thread
+#define BLOCK_POOL_BATCH        32u     // moved to or from the depot at once
+#define BLOCK_POOL_DEPOT_LIMIT  1024u   // per size class
+
+struct Block_pool_header {
+    uintptr_t sizeClass;
+    struct Block_pool_header *next;     // while on a free list
+} __attribute__((aligned(16)));
+
+struct Block_pool_cache {
+    struct Block_pool_header *head[BLOCK_POOL_CLASS_COUNT];
+    unsigned int count[BLOCK_POOL_CLASS_COUNT];
+    bool registered;
+    bool exited;                        // the thread is being torn down
+};
+
+static __thread struct Block_pool_cache _Block_pool_cache;
+
+// The heads are only modified with the lock held, but are also peeked at
+// without it, hence the relaxed atomic accesses.
+static struct {
+    pthread_mutex_t lock;
+    struct Block_pool_header *head[BLOCK_POOL_CLASS_COUNT];
+    unsigned int count[BLOCK_POOL_CLASS_COUNT];
+} _Block_pool_depot = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static pthread_once_t _Block_pool_pred = PTHREAD_ONCE_INIT;
+static pthread_key_t _Block_pool_key;
+
+static void _Block_pool_depot_lock(void) {
+    pthread_mutex_lock(&_Block_pool_depot.lock);
+}
+
+static void _Block_pool_depot_unlock(void) {
+    pthread_mutex_unlock(&_Block_pool_depot.lock);
+}
+
+// Gives `n` blocks of the cache to the depot, frees what doesn't fit.
+static void _Block_pool_flush(struct Block_pool_cache *cache, unsigned long sizeClass, unsigned int n) {
+    struct Block_pool_header *h, *excess = NULL;
+
+    _Block_pool_depot_lock();
+    while (n-- && (h = cache->head[sizeClass])) {
+        cache->head[sizeClass] = h->next;
+        cache->count[sizeClass]--;
+        if (_Block_pool_depot.count[sizeClass] < BLOCK_POOL_DEPOT_LIMIT) {
+            h->next = _Block_pool_depot.head[sizeClass];
+            __atomic_store_n(&_Block_pool_depot.head[sizeClass], h,
+                    __ATOMIC_RELAXED);
+            _Block_pool_depot.count[sizeClass]++;
+        } else {
+            h->next = excess;
+            excess = h;
+        }
+    }
+    _Block_pool_depot_unlock();
+
+    while ((h = excess)) {
+        excess = h->next;
+        free(h);
+    }
+}
+
+static void _Block_pool_thread_exit(void *ctxt) {
+    struct Block_pool_cache *cache = (struct Block_pool_cache *)ctxt;
+    unsigned long sizeClass;
+
+    for (sizeClass = 0; sizeClass < BLOCK_POOL_CLASS_COUNT; sizeClass++) {
+        _Block_pool_flush(cache, sizeClass, cache->count[sizeClass]);
+    }
+    // blocks released by later thread specific destructors bypass the cache,
+    // see _Block_pool_free()
+    cache->exited = true;
+}
+
+static void _Block_pool_init(void) {
+    // the depot may be locked by another thread when forking
+    pthread_atfork(_Block_pool_depot_lock, _Block_pool_depot_unlock,
+            _Block_pool_depot_unlock);
+    if (pthread_key_create(&_Block_pool_key, _Block_pool_thread_exit) != 0) {
+        abort();
+    }
+}
+
+// Makes sure the cache of an exiting thread is given back to the depot.
+static void _Block_pool_register(struct Block_pool_cache *cache) {
+    pthread_once(&_Block_pool_pred, _Block_pool_init);
+    pthread_setspecific(_Block_pool_key, cache);
+    cache->registered = true;
+}
+
+static struct Block_pool_header *_Block_pool_refill(struct Block_pool_cache *cache, unsigned long sizeClass) {
+    struct Block_pool_header *h;
+    unsigned int n = BLOCK_POOL_BATCH;
+
+    // an exiting thread would take a batch nothing gives back
+    if (cache->exited) return NULL;
+    // racy peek so that threads which never free don't take the lock each time
+    if (!__atomic_load_n(&_Block_pool_depot.head[sizeClass], __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+
+    _Block_pool_depot_lock();
+    while (n-- && (h = _Block_pool_depot.head[sizeClass])) {
+        __atomic_store_n(&_Block_pool_depot.head[sizeClass], h->next,
+                __ATOMIC_RELAXED);
+        _Block_pool_depot.count[sizeClass]--;
+        h->next = cache->head[sizeClass];
+        cache->head[sizeClass] = h;
+        cache->count[sizeClass]++;
+    }
+    _Block_pool_depot_unlock();
+
+    if (cache->head[sizeClass] && !cache->registered) {
+        _Block_pool_register(cache);
+    }
+    return cache->head[sizeClass];
+}
+
+static void *_Block_pool_alloc(const unsigned long size) {
+    struct Block_pool_cache *cache = &_Block_pool_cache;
+    struct Block_pool_header *h;
+    unsigned long sizeClass;
+
+    if (size == 0 || size > BLOCK_POOL_MAX_SIZE) {
+        h = (struct Block_pool_header *)malloc(sizeof(*h) + size);
+        if (!h) return NULL;
+        h->sizeClass = BLOCK_POOL_LARGE;
+        return h + 1;
+    }
+
+    sizeClass = (size - 1) / BLOCK_POOL_QUANTUM;
+    h = cache->head[sizeClass];
+    if (!h) h = _Block_pool_refill(cache, sizeClass);
+    if (h) {
+        cache->head[sizeClass] = h->next;
+        cache->count[sizeClass]--;
+        return h + 1;
+    }
+
+    h = (struct Block_pool_header *)malloc(sizeof(*h) +
+            (sizeClass + 1) * BLOCK_POOL_QUANTUM);
+    if (!h) return NULL;
+    h->sizeClass = sizeClass;
+    return h + 1;
+}
+
+static void _Block_pool_free(const void *ptr) {
+    struct Block_pool_cache *cache = &_Block_pool_cache;
+    struct Block_pool_header *h = (struct Block_pool_header *)ptr - 1;
+    unsigned long sizeClass = h->sizeClass;
+
+    if (sizeClass == BLOCK_POOL_LARGE) {
+        free(h);
+        return;
+    }
+
+    os_assert(sizeClass < BLOCK_POOL_CLASS_COUNT);
+    h->next = cache->head[sizeClass];
+    cache->head[sizeClass] = h;
+    cache->count[sizeClass]++;
+    if (cache->exited) {
+        // the thread exit cleanup already ran and won't run again
+        _Block_pool_flush(cache, sizeClass, cache->count[sizeClass]);
+        return;
+    }
+    if (cache->count[sizeClass] > BLOCK_POOL_CACHE_LIMIT) {
+        _Block_pool_flush(cache, sizeClass, BLOCK_POOL_BATCH);
+    }
+    if (!cache->registered) {
+        _Block_pool_register(cache);
+    }
+}
+#endif // BLOCK_USE_POOLED_ALLOCATOR
+
 /***********************
 GC support stub routines
 ************************/
@@ -150,7 +363,11 @@ GC support stub routines
 static void *_Block_alloc_default(const unsigned long size, const bool initialCountIsOne, const bool isObject) {
 	(void)initialCountIsOne;
 	(void)isObject;
+#if BLOCK_USE_POOLED_ALLOCATOR
+    return _Block_pool_alloc(size);
+#else
     return malloc(size);
+#endif
 }
 
 static void _Block_assign_default(void *value, void **destptr) {
@@ -208,7 +425,11 @@ GC support callout functions - initially set to stub routines
 ***************************************************************************/
 
 static void *(*_Block_allocator)(const unsigned long, const bool isOne, const bool isObject) = _Block_alloc_default;
+#if BLOCK_USE_POOLED_ALLOCATOR
+static void (*_Block_deallocator)(const void *) = _Block_pool_free;
+#else
 static void (*_Block_deallocator)(const void *) = (void (*)(const void *))free;
+#endif
 static void (*_Block_assign)(void *value, void **destptr) = _Block_assign_default;
 static void (*_Block_setHasRefcount)(const void *ptr, const bool hasRefcount) = _Block_setHasRefcount_default;
 static void (*_Block_retain_object)(const void *ptr) = _Block_retain_object_default;
@@ -371,7 +592,7 @@ static void *_Block_copy_internal(const void *arg, const bool wantsOne) {
 
     // Its a stack block.  Make a copy.
     if (!isGC) {
-        struct Block_layout *result = malloc(aBlock->descriptor->size);
+        struct Block_layout *result = _Block_allocator(aBlock->descriptor->size, wantsOne, false);
         if (!result) return NULL;
         memmove(result, aBlock, aBlock->descriptor->size); // bitcopy first
         // reset refcount
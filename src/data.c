@@ -360,6 +360,28 @@ dispatch_data_create_concat(dispatch_data_t dd1, dispatch_data_t dd2)
 	return data;
 }
 
+dispatch_data_t
+_dispatch_data_create_with_records(const range_record *records, size_t n)
+{
+	dispatch_data_t data;
+	size_t i, size = 0;
+
+	if (!n) {
+		return dispatch_data_empty;
+	}
+	// Records are kept as given (rather than coalesced) so that
+	// dispatch_data_apply() visits each of them as a separate region
+	data = _dispatch_data_alloc(n, 0);
+	for (i = 0; i < n; i++) {
+		dispatch_assert(records[i].length);
+		data->records[i] = records[i];
+		size += records[i].length;
+		_dispatch_data_retain(records[i].data_object);
+	}
+	data->size = size;
+	return data;
+}
+
 dispatch_data_t
 dispatch_data_create_subrange(dispatch_data_t dd, size_t offset,
 		size_t length)
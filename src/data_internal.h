@@ -109,6 +109,8 @@ void _dispatch_data_set_target_queue(struct dispatch_data_s *dd,
 #endif
 size_t _dispatch_data_debug(dispatch_data_t data, char* buf, size_t bufsiz);
 const void* _dispatch_data_get_flattened_bytes(struct dispatch_data_s *dd);
+dispatch_data_t _dispatch_data_create_with_records(const range_record *records,
+		size_t n);
 
 #if !defined(__cplusplus)
 extern const dispatch_block_t _dispatch_data_destructor_inline;
@@ -81,7 +81,16 @@ _dispatch_unote_create_with_fd(dispatch_source_type_t dst,
 		return DISPATCH_UNOTE_NULL;
 	}
 #endif
-	return _dispatch_unote_create(dst, handle, mask);
+	dispatch_unote_t du = _dispatch_unote_create(dst, handle, mask);
+#if DISPATCH_EVENT_BACKEND_EPOLL
+	if (du._du && (dst->dst_filter == EVFILT_READ ||
+			dst->dst_filter == EVFILT_WRITE)) {
+		// the buffer size is only queried if the handler asks for it,
+		// see _dispatch_unote_get_lazy_data()
+		du._du->du_data_is_lazy = true;
+	}
+#endif
+	return du;
 }
 
 DISPATCH_NOINLINE
@@ -117,6 +126,13 @@ _dispatch_unote_dispose(dispatch_unote_t du)
 	} else if (!du._du->du_is_direct) {
 		ptr = _dispatch_unote_get_linkage(du);
 	}
+	if (du._du->du_type == &_dispatch_source_type_fd_set) {
+		(void)dispatch_assume_zero(close((int)du._du->du_ident));
+	}
+	if (du._du->du_is_inline) {
+		// the storage belongs to the source and is freed along with it
+		return;
+	}
 	free(ptr);
 }
 
@@ -145,6 +161,7 @@ _dispatch_unote_register(dispatch_unote_t du, dispatch_wlh_t wlh,
 	case DISPATCH_EVFILT_CUSTOM_ADD:
 	case DISPATCH_EVFILT_CUSTOM_OR:
 	case DISPATCH_EVFILT_CUSTOM_REPLACE:
+	case DISPATCH_EVFILT_CUSTOM_VECTOR:
 		_dispatch_unote_state_set(du, DISPATCH_WLH_ANON, DU_STATE_ARMED);
 		return true;
 	}
@@ -185,6 +202,7 @@ _dispatch_unote_unregister(dispatch_unote_t du, uint32_t flags)
 	case DISPATCH_EVFILT_CUSTOM_ADD:
 	case DISPATCH_EVFILT_CUSTOM_OR:
 	case DISPATCH_EVFILT_CUSTOM_REPLACE:
+	case DISPATCH_EVFILT_CUSTOM_VECTOR:
 		_dispatch_unote_state_set(du, DU_STATE_UNREGISTERED);
 		return true;
 	}
@@ -257,6 +275,18 @@ const dispatch_source_type_s _dispatch_source_type_data_replace = {
 	.dst_merge_evt  = NULL,
 };
 
+const dispatch_source_type_s _dispatch_source_type_data_vector = {
+	.dst_kind       = "data-vector",
+	.dst_filter     = DISPATCH_EVFILT_CUSTOM_VECTOR,
+	.dst_flags      = EV_UDATA_SPECIFIC|EV_CLEAR,
+	.dst_action     = DISPATCH_UNOTE_ACTION_PASS_DATA,
+	.dst_size       = sizeof(struct dispatch_source_vector_refs_s),
+	.dst_strict     = false,
+
+	.dst_create     = _dispatch_source_data_create,
+	.dst_merge_evt  = NULL,
+};
+
 #pragma mark file descriptors
 
 const dispatch_source_type_s _dispatch_source_type_read = {
@@ -295,6 +325,48 @@ const dispatch_source_type_s _dispatch_source_type_write = {
 	.dst_merge_evt  = _dispatch_source_merge_evt,
 };
 
+#pragma mark fd sets
+
+static dispatch_unote_t
+_dispatch_source_fd_set_create(dispatch_source_type_t dst, uintptr_t handle,
+		unsigned long mask)
+{
+	dispatch_unote_t du;
+	int pfd;
+
+	if (handle || mask) {
+		return DISPATCH_UNOTE_NULL;
+	}
+
+	// the source monitors the readability of a private poller that holds the
+	// file descriptors of the set, closed by _dispatch_unote_dispose()
+	pfd = _dispatch_fd_set_poller_create();
+	if (unlikely(pfd < 0)) {
+		(void)dispatch_assume_zero(errno);
+		return DISPATCH_UNOTE_NULL;
+	}
+	du = _dispatch_unote_create_with_fd(dst, (uintptr_t)pfd, 0);
+	if (unlikely(!du._du)) {
+		(void)dispatch_assume_zero(close(pfd));
+	}
+	return du;
+}
+
+const dispatch_source_type_s _dispatch_source_type_fd_set = {
+	.dst_kind       = "fd-set",
+	.dst_filter     = EVFILT_READ,
+	.dst_flags      = EV_UDATA_SPECIFIC|EV_DISPATCH|EV_VANISHED,
+#if DISPATCH_EVENT_BACKEND_KEVENT
+	.dst_data       = 1,
+#endif // DISPATCH_EVENT_BACKEND_KEVENT
+	.dst_action     = DISPATCH_UNOTE_ACTION_SOURCE_SET_DATA,
+	.dst_size       = sizeof(struct dispatch_source_refs_s),
+	.dst_strict     = false,
+
+	.dst_create     = _dispatch_source_fd_set_create,
+	.dst_merge_evt  = _dispatch_source_merge_evt,
+};
+
 #pragma mark signals
 
 static dispatch_unote_t
@@ -319,13 +391,63 @@ const dispatch_source_type_s _dispatch_source_type_signal = {
 	.dst_merge_evt  = _dispatch_source_merge_evt,
 };
 
+#pragma mark -
+#pragma mark muxnote table
+
+static void
+_dispatch_muxnote_table_resize(dispatch_muxnote_table_t dmt, uint32_t size)
+{
+	struct dispatch_muxnote_bucket_s *buckets, *dmb;
+	dispatch_muxnote_class_t dmn;
+	uint32_t i, old_size = dmt->dmt_buckets ? dmt->dmt_mask + 1 : 0;
+
+	buckets = _dispatch_calloc(size, sizeof(struct dispatch_muxnote_bucket_s));
+	for (i = 0; i < old_size; i++) {
+		dmb = &dmt->dmt_buckets[i];
+		while ((dmn = LIST_FIRST(dmb))) {
+			LIST_REMOVE(dmn, dmn_list);
+			LIST_INSERT_HEAD(&buckets[dmn->dmn_hash & (size - 1)],
+					dmn, dmn_list);
+		}
+	}
+	free(dmt->dmt_buckets);
+	dmt->dmt_buckets = buckets;
+	dmt->dmt_mask = size - 1;
+}
+
+void
+_dispatch_muxnote_table_insert(dispatch_muxnote_table_t dmt,
+		dispatch_muxnote_class_t dmn, uint32_t hash)
+{
+	if (unlikely(!dmt->dmt_buckets)) {
+		_dispatch_muxnote_table_resize(dmt, DISPATCH_MUXNOTE_TABLE_MIN_SIZE);
+	} else if (unlikely(dmt->dmt_count > dmt->dmt_mask)) {
+		if (unlikely(dmt->dmt_mask >= UINT32_MAX / 2)) {
+			DISPATCH_INTERNAL_CRASH(dmt->dmt_count, "Muxnote table overflow");
+		}
+		_dispatch_muxnote_table_resize(dmt, 2 * (dmt->dmt_mask + 1));
+	}
+	dmn->dmn_hash = hash;
+	LIST_INSERT_HEAD(&dmt->dmt_buckets[hash & dmt->dmt_mask], dmn, dmn_list);
+	dmt->dmt_count++;
+}
+
+void
+_dispatch_muxnote_table_remove(dispatch_muxnote_table_t dmt,
+		dispatch_muxnote_class_t dmn)
+{
+	LIST_REMOVE(dmn, dmn_list);
+	dmt->dmt_count--;
+}
+
 #pragma mark -
 #pragma mark timer globals
 
 DISPATCH_GLOBAL(struct dispatch_timer_heap_s
 _dispatch_timers_heap[DISPATCH_TIMER_COUNT]);
+DISPATCH_GLOBAL(dispatch_after_pending_s _dispatch_after_pending);
 
-#if DISPATCH_USE_DTRACE
+#if DISPATCH_USE_DTRACE || DISPATCH_USE_SDT
 DISPATCH_STATIC_GLOBAL(dispatch_timer_source_refs_t
 _dispatch_trace_next_timer[DISPATCH_TIMER_QOS_COUNT]);
 #define _dispatch_trace_next_timer_set(x, q) \
@@ -1009,19 +1131,6 @@ const dispatch_source_type_s _dispatch_source_type_timer_with_clock = {
 	.dst_merge_evt      = _dispatch_source_merge_evt,
 };
 
-const dispatch_source_type_s _dispatch_source_type_after = {
-	.dst_kind           = "timer (after)",
-	.dst_filter         = DISPATCH_EVFILT_TIMER_WITH_CLOCK,
-	.dst_flags          = EV_DISPATCH,
-	.dst_mask           = 0,
-	.dst_timer_flags    = DISPATCH_TIMER_AFTER,
-	.dst_action         = DISPATCH_UNOTE_ACTION_SOURCE_TIMER,
-	.dst_size           = sizeof(struct dispatch_timer_source_refs_s),
-
-	.dst_create         = _dispatch_source_timer_create,
-	.dst_merge_evt      = _dispatch_source_merge_evt,
-};
-
 const dispatch_source_type_s _dispatch_source_type_interval = {
 	.dst_kind           = "timer (interval)",
 	.dst_filter         = DISPATCH_EVFILT_TIMER_WITH_CLOCK,
@@ -1036,6 +1145,50 @@ const dispatch_source_type_s _dispatch_source_type_interval = {
 	.dst_merge_evt      = _dispatch_source_merge_evt,
 };
 
+#pragma mark dispatch_after timers
+
+void
+_dispatch_after_timer_enqueue(dispatch_after_refs_t dar)
+{
+	if (os_mpsc_push_item(os_mpsc(&_dispatch_after_pending, dap), dar,
+			dar_next)) {
+		_dispatch_event_loop_poke(DISPATCH_WLH_MANAGER, 0, 0);
+	}
+}
+
+void
+_dispatch_after_timers_arm_pending(void)
+{
+	dispatch_after_refs_t dar, tail;
+	dispatch_timer_source_refs_t dt;
+
+	dar = os_mpsc_capture_snapshot(os_mpsc(&_dispatch_after_pending, dap),
+			&tail);
+	for (; dar; dar = os_mpsc_pop_snapshot_head(dar, tail, dar_next)) {
+		dt = &dar->dar_timer;
+		_dispatch_timer_unote_arm(dt, _dispatch_timers_heap,
+				_dispatch_timer_unote_idx(dt));
+	}
+}
+
+static void
+_dispatch_after_timer_fire(dispatch_after_refs_t dar,
+		dispatch_timer_heap_t dth)
+{
+	dispatch_continuation_t dc = dar->dar_timer.ds_handler[DS_EVENT_HANDLER];
+	dispatch_queue_t dq = dar->dar_queue;
+
+	_dispatch_timer_unote_disarm(&dar->dar_timer, dth);
+	_dispatch_trace_after_fire(dq, dc);
+	_dispatch_stats_inc(dispatch_stat_timer_fire);
+	free(dar);
+
+	_dispatch_continuation_latency_restamp(dc);
+	_dispatch_continuation_async(dq, dc,
+			_dispatch_qos_from_pp(dc->dc_priority), dc->dc_flags);
+	_dispatch_release_2(dq); // see _dispatch_after
+}
+
 #pragma mark timer draining
 
 static void
@@ -1056,12 +1209,7 @@ _dispatch_timers_run(dispatch_timer_heap_t dth, uint32_t tidx,
 		}
 
 		if (dr->du_timer_flags & DISPATCH_TIMER_AFTER) {
-			_dispatch_timer_unote_disarm(dr, dth); // +2 is consumed by _merge_evt()
-			_dispatch_wlh_release(_dispatch_unote_wlh(dr));
-			_dispatch_unote_state_set(dr, DU_STATE_UNREGISTERED);
-			os_atomic_store2o(dr, ds_pending_data, 2, relaxed);
-			_dispatch_trace_timer_fire(dr, 1, 1);
-			dux_merge_evt(dr, EV_ONESHOT, 0, 0);
+			_dispatch_after_timer_fire((dispatch_after_refs_t)dr, dth);
 			continue;
 		}
 
@@ -1110,6 +1258,7 @@ _dispatch_timers_run(dispatch_timer_heap_t dth, uint32_t tidx,
 			}
 		}
 		_dispatch_trace_timer_fire(dr, pending >> 1, pending >> 1);
+		_dispatch_stats_inc(dispatch_stat_timer_fire);
 		dux_merge_evt(dr, EV_ONESHOT, 0, 0);
 	}
 }
@@ -1217,14 +1366,14 @@ _dispatch_event_loop_drain_timers(dispatch_timer_heap_t dth, uint32_t count)
 			_dispatch_timers_run(dth, tidx, &nows);
 		}
 
-#if DISPATCH_USE_DTRACE
+#if DISPATCH_USE_DTRACE || DISPATCH_USE_SDT
 		uint32_t mask = dth[0].dth_dirty_bits & DTH_DIRTY_QOS_MASK;
 		while (mask && DISPATCH_TIMER_WAKE_ENABLED()) {
 			int qos = __builtin_ctz(mask);
 			mask -= 1 << qos;
 			_dispatch_trace_timer_wake(_dispatch_trace_next_timer[qos]);
 		}
-#endif // DISPATCH_USE_DTRACE
+#endif // DISPATCH_USE_DTRACE || DISPATCH_USE_SDT
 
 		dth[0].dth_dirty_bits = 0;
 
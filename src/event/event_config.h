@@ -46,6 +46,27 @@
 #define DISPATCH_WLH_DEBUG 0
 #endif
 
+// When a dispatch_sync() waiter finds the queue drained by a thread running
+// at a lower priority, temporarily lend it the waiter's nice value so that
+// it reaches the waiter sooner (Linux has no kernel QoS override for this).
+#ifndef DISPATCH_USE_SYNC_OWNER_BOOST
+#if DISPATCH_EVENT_BACKEND_EPOLL
+#define DISPATCH_USE_SYNC_OWNER_BOOST 1
+#else
+#define DISPATCH_USE_SYNC_OWNER_BOOST 0
+#endif
+#endif
+
+// Timer sources directly targeting a workloop are kept in a heap owned by
+// that workloop, with its own timerfds, rather than in the manager's heaps.
+#ifndef DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+#if DISPATCH_EVENT_BACKEND_EPOLL
+#define DISPATCH_USE_WORKLOOP_TIMER_HEAPS 1
+#else
+#define DISPATCH_USE_WORKLOOP_TIMER_HEAPS 0
+#endif
+#endif
+
 #ifndef DISPATCH_MACHPORT_DEBUG
 #define DISPATCH_MACHPORT_DEBUG 0
 #endif
@@ -150,8 +171,15 @@
 #	define EVFILT_TIMER				(-4)
 #	define EVFILT_SYSCOUNT			4
 
+#	if DISPATCH_EVENT_BACKEND_EPOLL
+	// timers of all QoS buckets of a clock share a timerfd, which is
+	// programmed to fire as late as their leeways allow (event_epoll.c)
+#	define DISPATCH_HAVE_TIMER_QOS 1
+#	define DISPATCH_HAVE_TIMER_COALESCING 1
+#	else
 #	define DISPATCH_HAVE_TIMER_QOS 0
 #	define DISPATCH_HAVE_TIMER_COALESCING 0
+#	endif
 #	define KEVENT_FLAG_IMMEDIATE 0x001
 #	define DISPATCH_HAVE_DIRECT_KNOTES 0
 #endif // !DISPATCH_EVENT_BACKEND_KEVENT
@@ -173,6 +201,7 @@
 #define DISPATCH_EVFILT_CUSTOM_OR			(-EVFILT_SYSCOUNT - 4)
 #define DISPATCH_EVFILT_CUSTOM_REPLACE		(-EVFILT_SYSCOUNT - 5)
 #define DISPATCH_EVFILT_MACH_NOTIFICATION	(-EVFILT_SYSCOUNT - 6)
+#define DISPATCH_EVFILT_CUSTOM_VECTOR		(-EVFILT_SYSCOUNT - 7)
 
 #if HAVE_MACH
 #	if !EV_UDATA_SPECIFIC
@@ -24,7 +24,9 @@
 #include <linux/sockios.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/resource.h>
 #include <sys/signalfd.h>
+#include <sys/syscall.h>
 #include <sys/timerfd.h>
 
 #ifndef EPOLLFREE
@@ -36,16 +38,21 @@
 #endif
 
 #define DISPATCH_EPOLL_MAX_EVENT_COUNT 16
+#define DISPATCH_EPOLL_MAX_SHARD_COUNT 16
 
 enum {
 	DISPATCH_EPOLL_EVENTFD         = 0x0001,
 	DISPATCH_EPOLL_CLOCK_WALL      = 0x0002,
 	DISPATCH_EPOLL_CLOCK_UPTIME    = 0x0003,
 	DISPATCH_EPOLL_CLOCK_MONOTONIC = 0x0004,
+	// tag of the (8-byte aligned) timeouts of workloop timers, the low bits
+	// of muxnote pointers are always clear and never match the idents above
+	DISPATCH_EPOLL_WORKLOOP_TIMER  = 0x0005,
+#define DISPATCH_EPOLL_WORKLOOP_TIMER_MASK 0x7ul
 };
 
 typedef struct dispatch_muxnote_s {
-	LIST_ENTRY(dispatch_muxnote_s) dmn_list;
+	DISPATCH_MUXNOTE_CLASS_HEADER();
 	LIST_HEAD(, dispatch_unote_linkage_s) dmn_readers_head;
 	LIST_HEAD(, dispatch_unote_linkage_s) dmn_writers_head;
 	int       dmn_fd;
@@ -53,6 +60,7 @@ typedef struct dispatch_muxnote_s {
 	uint32_t  dmn_events;
 	uint16_t  dmn_disarmed_events;
 	int8_t    dmn_filter;
+	uint8_t   dmn_shard;
 	bool      dmn_skip_outq_ioctl : 1;
 	bool      dmn_skip_inq_ioctl : 1;
 } *dispatch_muxnote_t;
@@ -62,20 +70,49 @@ typedef struct dispatch_epoll_timeout_s {
 	uint16_t  det_ident;
 	bool      det_registered;
 	bool      det_armed;
+	uint64_t  det_programmed;
+	// [target, deadline] window requested by each timer QoS bucket
+	uint64_t  det_target[DISPATCH_TIMER_QOS_COUNT];
+	uint64_t  det_deadline[DISPATCH_TIMER_QOS_COUNT];
 } *dispatch_epoll_timeout_t;
 
-static int _dispatch_epfd, _dispatch_eventfd;
+/*
+ * File descriptors are spread over several epoll instances (shards) so that
+ * a single thread doesn't have to wait for and merge every readiness event.
+ *
+ * Shard 0 is drained by the manager thread and also holds the timers and
+ * signals, the other shards each have their own drainer thread. Muxnotes are
+ * still registered, resumed and unregistered from the manager thread, the
+ * shard lock serializes this with the drainer of the shard.
+ *
+ * Muxnotes of other shards are disposed of by their drainer, as an event for
+ * them may have been returned by an epoll_wait() that ran concurrently with
+ * their unregistration.
+ */
+typedef struct dispatch_epoll_shard_s {
+	int       des_epfd;
+	int       des_eventfd;
+	dispatch_unfair_lock_s des_lock;
+	LIST_HEAD(, dispatch_muxnote_class_s) des_disposed_head;
+} *dispatch_epoll_shard_t;
+
+static struct dispatch_epoll_shard_s
+_dispatch_epoll_shards[DISPATCH_EPOLL_MAX_SHARD_COUNT];
+static uint32_t _dispatch_epoll_shard_count = 1;
+#define _dispatch_epoll_mgr_shard (&_dispatch_epoll_shards[0])
 
 static dispatch_once_t epoll_init_pred;
 static void _dispatch_epoll_init(void *);
 
-static LIST_HEAD(dispatch_muxnote_bucket_s, dispatch_muxnote_s)
-_dispatch_sources[DSL_HASH_SIZE];
+static struct dispatch_muxnote_table_s _dispatch_sources;
 
 #define DISPATCH_EPOLL_TIMEOUT_INITIALIZER(clock) \
 	[DISPATCH_CLOCK_##clock] = { \
 		.det_fd = -1, \
 		.det_ident = DISPATCH_EPOLL_CLOCK_##clock, \
+		.det_programmed = UINT64_MAX, \
+		.det_target = { [0 ... DISPATCH_TIMER_QOS_COUNT - 1] = UINT64_MAX }, \
+		.det_deadline = { [0 ... DISPATCH_TIMER_QOS_COUNT - 1] = UINT64_MAX }, \
 	}
 static struct dispatch_epoll_timeout_s _dispatch_epoll_timeout[] = {
 	DISPATCH_EPOLL_TIMEOUT_INITIALIZER(WALL),
@@ -92,31 +129,49 @@ _dispatch_muxnote_armed_events(dispatch_muxnote_t dmn)
 	return dmn->dmn_events & ~dmn->dmn_disarmed_events;
 }
 
-DISPATCH_ALWAYS_INLINE
-static inline struct dispatch_muxnote_bucket_s *
-_dispatch_muxnote_bucket(uint32_t ident)
-{
-	return &_dispatch_sources[DSL_HASH(ident)];
-}
-#define _dispatch_unote_muxnote_bucket(du) \
-	_dispatch_muxnote_bucket(du._du->du_ident)
-
 DISPATCH_ALWAYS_INLINE
 static inline dispatch_muxnote_t
-_dispatch_muxnote_find(struct dispatch_muxnote_bucket_s *dmb,
-		uint32_t ident, int8_t filter)
+_dispatch_muxnote_find(uint32_t ident, int8_t filter)
 {
-	dispatch_muxnote_t dmn;
+	struct dispatch_muxnote_bucket_s *dmb;
+	dispatch_muxnote_class_t dmnc;
+
+	// fds and signal numbers are small integers, use them as the hash as is
+	dmb = _dispatch_muxnote_table_bucket(&_dispatch_sources, ident);
+	if (unlikely(!dmb)) {
+		return NULL;
+	}
 	if (filter == EVFILT_WRITE) filter = EVFILT_READ;
-	LIST_FOREACH(dmn, dmb, dmn_list) {
+	LIST_FOREACH(dmnc, dmb, dmn_list) {
+		dispatch_muxnote_t dmn = (dispatch_muxnote_t)dmnc;
 		if (dmn->dmn_ident == ident && dmn->dmn_filter == filter) {
-			break;
+			return dmn;
 		}
 	}
-	return dmn;
+	return NULL;
+}
+#define _dispatch_unote_muxnote_find(du) \
+		_dispatch_muxnote_find(du._du->du_ident, du._du->du_filter)
+
+DISPATCH_ALWAYS_INLINE
+static inline uint8_t
+_dispatch_unote_shard(dispatch_unote_t du)
+{
+	switch (du._du->du_filter) {
+	case EVFILT_READ:
+	case EVFILT_WRITE:
+		return (uint8_t)(du._du->du_ident % _dispatch_epoll_shard_count);
+	default:
+		return 0;
+	}
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_epoll_shard_t
+_dispatch_muxnote_shard(dispatch_muxnote_t dmn)
+{
+	return &_dispatch_epoll_shards[dmn->dmn_shard];
 }
-#define _dispatch_unote_muxnote_find(dmb, du) \
-		_dispatch_muxnote_find(dmb, du._du->du_ident, du._du->du_filter)
 
 static void
 _dispatch_muxnote_dispose(dispatch_muxnote_t dmn)
@@ -207,6 +262,7 @@ _dispatch_muxnote_create(dispatch_unote_t du, uint32_t events)
 	dmn->dmn_fd = fd;
 	dmn->dmn_ident = du._du->du_ident;
 	dmn->dmn_filter = filter;
+	dmn->dmn_shard = _dispatch_unote_shard(du);
 	dmn->dmn_events = events;
 	dmn->dmn_skip_outq_ioctl = skip_outq_ioctl;
 	dmn->dmn_skip_inq_ioctl = skip_inq_ioctl;
@@ -223,7 +279,8 @@ _dispatch_epoll_update(dispatch_muxnote_t dmn, uint32_t events, int op)
 		.events = events,
 		.data = { .ptr = dmn },
 	};
-	return epoll_ctl(_dispatch_epfd, op, dmn->dmn_fd, &ev);
+	return epoll_ctl(_dispatch_muxnote_shard(dmn)->des_epfd, op,
+			dmn->dmn_fd, &ev);
 }
 
 DISPATCH_ALWAYS_INLINE
@@ -236,6 +293,7 @@ _dispatch_unote_required_events(dispatch_unote_t du)
 	case DISPATCH_EVFILT_CUSTOM_ADD:
 	case DISPATCH_EVFILT_CUSTOM_OR:
 	case DISPATCH_EVFILT_CUSTOM_REPLACE:
+	case DISPATCH_EVFILT_CUSTOM_VECTOR:
 		return 0;
 	case EVFILT_WRITE:
 		events |= EPOLLOUT;
@@ -255,15 +313,17 @@ _dispatch_unote_required_events(dispatch_unote_t du)
 bool
 _dispatch_unote_register_muxed(dispatch_unote_t du)
 {
-	struct dispatch_muxnote_bucket_s *dmb;
+	dispatch_epoll_shard_t des;
 	dispatch_muxnote_t dmn;
 	uint32_t events;
 
+	dispatch_once_f(&epoll_init_pred, NULL, _dispatch_epoll_init);
 	events = _dispatch_unote_required_events(du);
 	du._du->du_priority = pri;
 
-	dmb = _dispatch_unote_muxnote_bucket(du);
-	dmn = _dispatch_unote_muxnote_find(dmb, du);
+	des = &_dispatch_epoll_shards[_dispatch_unote_shard(du)];
+	_dispatch_unfair_lock_lock(&des->des_lock);
+	dmn = _dispatch_unote_muxnote_find(du);
 	if (dmn) {
 		if (events & ~_dispatch_muxnote_armed_events(dmn)) {
 			events |= _dispatch_muxnote_armed_events(dmn);
@@ -281,7 +341,8 @@ _dispatch_unote_register_muxed(dispatch_unote_t du)
 				_dispatch_muxnote_dispose(dmn);
 				dmn = NULL;
 			} else {
-				LIST_INSERT_HEAD(dmb, dmn, dmn_list);
+				_dispatch_muxnote_table_insert(&_dispatch_sources,
+						(dispatch_muxnote_class_t)dmn, dmn->dmn_ident);
 			}
 		}
 	}
@@ -296,6 +357,7 @@ _dispatch_unote_register_muxed(dispatch_unote_t du)
 		dul->du_muxnote = dmn;
 		_dispatch_unote_state_set(du, DISPATCH_WLH_ANON, DU_STATE_ARMED);
 	}
+	_dispatch_unfair_lock_unlock(&des->des_lock);
 	return dmn != NULL;
 }
 
@@ -303,14 +365,17 @@ void
 _dispatch_unote_resume_muxed(dispatch_unote_t du)
 {
 	dispatch_muxnote_t dmn = _dispatch_unote_get_linkage(du)->du_muxnote;
+	dispatch_epoll_shard_t des = _dispatch_muxnote_shard(dmn);
 	dispatch_assert(_dispatch_unote_registered(du));
 	uint32_t events = _dispatch_unote_required_events(du);
 
+	_dispatch_unfair_lock_lock(&des->des_lock);
 	if (events & dmn->dmn_disarmed_events) {
 		dmn->dmn_disarmed_events &= ~events;
 		events = _dispatch_muxnote_armed_events(dmn);
 		_dispatch_epoll_update(dmn, events, EPOLL_CTL_MOD);
 	}
+	_dispatch_unfair_lock_unlock(&des->des_lock);
 }
 
 bool
@@ -318,8 +383,11 @@ _dispatch_unote_unregister_muxed(dispatch_unote_t du)
 {
 	dispatch_unote_linkage_t dul = _dispatch_unote_get_linkage(du);
 	dispatch_muxnote_t dmn = dul->du_muxnote;
-	uint32_t events = dmn->dmn_events;
+	dispatch_epoll_shard_t des = _dispatch_muxnote_shard(dmn);
+	uint32_t events;
 
+	_dispatch_unfair_lock_lock(&des->des_lock);
+	events = dmn->dmn_events;
 	LIST_REMOVE(dul, du_link);
 	_LIST_TRASH_ENTRY(dul, du_link);
 	dul->du_muxnote = NULL;
@@ -346,11 +414,23 @@ _dispatch_unote_unregister_muxed(dispatch_unote_t du)
 			_dispatch_epoll_update(dmn, events, EPOLL_CTL_MOD);
 		}
 	} else {
-		epoll_ctl(_dispatch_epfd, EPOLL_CTL_DEL, dmn->dmn_fd, NULL);
-		LIST_REMOVE(dmn, dmn_list);
-		_dispatch_muxnote_dispose(dmn);
+		epoll_ctl(des->des_epfd, EPOLL_CTL_DEL, dmn->dmn_fd, NULL);
+		_dispatch_muxnote_table_remove(&_dispatch_sources,
+				(dispatch_muxnote_class_t)dmn);
+		if (des == _dispatch_epoll_mgr_shard) {
+			_dispatch_muxnote_dispose(dmn);
+		} else {
+			// the drainer of the shard may still be looking at an event
+			// for this muxnote, make sure it doesn't rearm it and let it
+			// dispose of it, see _dispatch_epoll_shard_drain()
+			dmn->dmn_events = 0;
+			LIST_INSERT_HEAD(&des->des_disposed_head,
+					(dispatch_muxnote_class_t)dmn, dmn_list);
+			dispatch_assume_zero(eventfd_write(des->des_eventfd, 1));
+		}
 	}
 	_dispatch_unote_state_set(du, DU_STATE_UNREGISTERED);
+	_dispatch_unfair_lock_unlock(&des->des_lock);
 	return true;
 }
 
@@ -360,18 +440,98 @@ static void
 _dispatch_event_merge_timer(dispatch_clock_t clock)
 {
 	dispatch_timer_heap_t dth = _dispatch_timers_heap;
-	uint32_t tidx = DISPATCH_TIMER_INDEX(clock, 0);
+	dispatch_epoll_timeout_t timer = &_dispatch_epoll_timeout[clock];
+
+	timer->det_armed = false;
+	timer->det_programmed = UINT64_MAX;
+
+	// all the QoS buckets of this clock share the timerfd, they will all be
+	// reprogrammed by _dispatch_event_loop_drain_timers()
+	for (uint32_t qos = 0; qos < DISPATCH_TIMER_QOS_COUNT; qos++) {
+		uint32_t tidx = DISPATCH_TIMER_INDEX(clock, qos);
+		timer->det_target[qos] = timer->det_deadline[qos] = UINT64_MAX;
+		_dispatch_timers_heap_dirty(dth, tidx);
+		dth[tidx].dth_needs_program = true;
+		dth[tidx].dth_armed = false;
+	}
+}
+
+// Returns the latest time at which the timerfd can fire without missing the
+// deadline of any QoS bucket, so that a single wakeup serves as many buckets
+// as possible: the latest target that isn't past the earliest deadline.
+DISPATCH_ALWAYS_INLINE
+static inline uint64_t
+_dispatch_timeout_coalesce(dispatch_epoll_timeout_t timer)
+{
+	uint64_t deadline = UINT64_MAX, target = 0;
+
+	for (uint32_t qos = 0; qos < DISPATCH_TIMER_QOS_COUNT; qos++) {
+		deadline = MIN(deadline, timer->det_deadline[qos]);
+	}
+	if (deadline == UINT64_MAX) {
+		return UINT64_MAX;
+	}
+	for (uint32_t qos = 0; qos < DISPATCH_TIMER_QOS_COUNT; qos++) {
+		if (timer->det_target[qos] <= deadline) {
+			target = MAX(target, timer->det_target[qos]);
+		}
+	}
+	return target;
+}
+
+// Records the window requested by the QoS bucket of `tidx` and returns the
+// target the timerfd of its clock should now be programmed for.
+static uint64_t
+_dispatch_timeout_update(dispatch_epoll_timeout_t timer, uint32_t tidx,
+		uint64_t target, uint64_t leeway)
+{
+	uint32_t qos = DISPATCH_TIMER_QOS(tidx);
 
-	_dispatch_epoll_timeout[clock].det_armed = false;
+	timer->det_target[qos] = target;
+	if (target >= INT64_MAX) {
+		timer->det_deadline[qos] = UINT64_MAX;
+	} else {
+		timer->det_deadline[qos] = MIN(target + leeway, INT64_MAX - 1);
+	}
+	return _dispatch_timeout_coalesce(timer);
+}
+
+static int
+_dispatch_timeout_create_fd(dispatch_clock_t clock)
+{
+	clockid_t clockid;
+	int fd;
+
+	switch (clock) {
+	case DISPATCH_CLOCK_UPTIME:
+		clockid = CLOCK_MONOTONIC;
+		break;
+	case DISPATCH_CLOCK_MONOTONIC:
+		clockid = CLOCK_BOOTTIME;
+		break;
+	case DISPATCH_CLOCK_WALL:
+		clockid = CLOCK_REALTIME;
+		break;
+	}
+	fd = timerfd_create(clockid, TFD_NONBLOCK | TFD_CLOEXEC);
+	(void)dispatch_assume(fd >= 0);
+	return fd;
+}
 
-	_dispatch_timers_heap_dirty(dth, tidx);
-	dth[tidx].dth_needs_program = true;
-	dth[tidx].dth_armed = false;
+static void
+_dispatch_timeout_settime(dispatch_epoll_timeout_t timer, uint64_t target)
+{
+	struct itimerspec its = { .it_value = {
+		.tv_sec  = target / NSEC_PER_SEC,
+		.tv_nsec = target % NSEC_PER_SEC,
+	} };
+	dispatch_assume_zero(timerfd_settime(timer->det_fd, TFD_TIMER_ABSTIME,
+			&its, NULL));
+	timer->det_programmed = target;
 }
 
 static void
-_dispatch_timeout_program(uint32_t tidx, uint64_t target,
-		DISPATCH_UNUSED uint64_t leeway)
+_dispatch_timeout_program(uint32_t tidx, uint64_t target, uint64_t leeway)
 {
 	dispatch_clock_t clock = DISPATCH_TIMER_CLOCK(tidx);
 	dispatch_epoll_timeout_t timer = &_dispatch_epoll_timeout[clock];
@@ -381,38 +541,25 @@ _dispatch_timeout_program(uint32_t tidx, uint64_t target,
 	};
 	int op;
 
+	target = _dispatch_timeout_update(timer, tidx, target, leeway);
+
 	if (target >= INT64_MAX && !timer->det_registered) {
 		return;
 	}
+	if (target == timer->det_programmed && timer->det_armed) {
+		// another bucket changed but the wakeup stays the same
+		return;
+	}
 
 	if (unlikely(timer->det_fd < 0)) {
-		clockid_t clockid;
-		int fd;
-		switch (DISPATCH_TIMER_CLOCK(tidx)) {
-		case DISPATCH_CLOCK_UPTIME:
-			clockid = CLOCK_MONOTONIC;
-			break;
-		case DISPATCH_CLOCK_MONOTONIC:
-			clockid = CLOCK_BOOTTIME;
-			break;
-		case DISPATCH_CLOCK_WALL:
-			clockid = CLOCK_REALTIME;
-			break;
-		}
-		fd = timerfd_create(clockid, TFD_NONBLOCK | TFD_CLOEXEC);
-		if (!dispatch_assume(fd >= 0)) {
+		timer->det_fd = _dispatch_timeout_create_fd(clock);
+		if (timer->det_fd < 0) {
 			return;
 		}
-		timer->det_fd = fd;
 	}
 
 	if (target < INT64_MAX) {
-		struct itimerspec its = { .it_value = {
-			.tv_sec  = target / NSEC_PER_SEC,
-			.tv_nsec = target % NSEC_PER_SEC,
-		} };
-		dispatch_assume_zero(timerfd_settime(timer->det_fd, TFD_TIMER_ABSTIME,
-				&its, NULL));
+		_dispatch_timeout_settime(timer, target);
 		if (!timer->det_registered) {
 			op = EPOLL_CTL_ADD;
 		} else if (!timer->det_armed) {
@@ -422,23 +569,255 @@ _dispatch_timeout_program(uint32_t tidx, uint64_t target,
 		}
 	} else {
 		op = EPOLL_CTL_DEL;
+		timer->det_programmed = UINT64_MAX;
 	}
-	dispatch_assume_zero(epoll_ctl(_dispatch_epfd, op, timer->det_fd, &ev));
+	dispatch_assume_zero(epoll_ctl(_dispatch_epoll_mgr_shard->des_epfd, op,
+			timer->det_fd, &ev));
 	timer->det_armed = timer->det_registered = (op != EPOLL_CTL_DEL);;
 }
 
+#pragma mark workloop timers
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+
+/*
+ * Timer sources directly targeting a workloop are kept in a heap owned by the
+ * workloop, that is only ever touched while the workloop is drained, so that
+ * arming, cancelling or reconfiguring them doesn't involve the manager.
+ *
+ * Each clock of the workloop has its own timerfd, registered edge-triggered
+ * on the manager shard once, and then only reprogrammed with
+ * timerfd_settime(). When a timerfd fires, the manager asks the workloop to
+ * run its timers with _dispatch_workloop_timers_merge().
+ *
+ * Whenever `det_armed` is set for one of these timerfds, it owns a reference
+ * on the workloop that is either consumed by the manager when the timerfd
+ * fires, or dropped by the workloop when it no longer needs the timerfd.
+ */
+typedef struct dispatch_workloop_timers_s {
+	struct dispatch_timer_heap_s dwt_heap[DISPATCH_TIMER_WLH_COUNT];
+	dispatch_workloop_t dwt_wlh;
+	uint32_t volatile dwt_fired; // clocks whose timerfd fired
+	LIST_ENTRY(dispatch_workloop_timers_s) dwt_list;
+	// det_ident is the clock of the timerfd
+	struct dispatch_epoll_timeout_s dwt_timeout[DISPATCH_CLOCK_COUNT];
+} *dispatch_workloop_timers_t;
+
+// workloop timers disposed of while the manager may still be looking at an
+// event for them, protected by the lock of the manager shard
+static LIST_HEAD(, dispatch_workloop_timers_s) _dispatch_workloop_timers_disposed;
+
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_workloop_timers_t
+_dispatch_workloop_timers_from_timeout(dispatch_epoll_timeout_t timer)
+{
+	timer -= timer->det_ident;
+	return (dispatch_workloop_timers_t)((char *)timer -
+			offsetof(struct dispatch_workloop_timers_s, dwt_timeout));
+}
+
+dispatch_timer_heap_t
+_dispatch_event_loop_workloop_timer_heap(dispatch_workloop_t dwl)
+{
+	dispatch_workloop_timers_t dwt;
+	dispatch_timer_heap_t dth;
+
+	dth = os_atomic_load2o(dwl, dwl_timer_heap, acquire);
+	if (likely(dth)) {
+		return dth;
+	}
+
+	dwt = _dispatch_calloc(1u, sizeof(struct dispatch_workloop_timers_s));
+	dwt->dwt_wlh = dwl;
+	for (uint32_t clock = 0; clock < DISPATCH_CLOCK_COUNT; clock++) {
+		dispatch_epoll_timeout_t timer = &dwt->dwt_timeout[clock];
+		timer->det_fd = -1;
+		timer->det_ident = (uint16_t)clock;
+		timer->det_programmed = UINT64_MAX;
+		for (uint32_t qos = 0; qos < DISPATCH_TIMER_QOS_COUNT; qos++) {
+			timer->det_target[qos] = timer->det_deadline[qos] = UINT64_MAX;
+		}
+	}
+
+	if (!os_atomic_cmpxchgv2o(dwl, dwl_timer_heap, NULL, dwt->dwt_heap,
+			&dth, release)) {
+		free(dwt);
+		return dth;
+	}
+	return dwt->dwt_heap;
+}
+
+void
+_dispatch_event_loop_workloop_timer_heap_dispose(dispatch_timer_heap_t dth)
+{
+	dispatch_workloop_timers_t dwt = (dispatch_workloop_timers_t)dth;
+	dispatch_epoll_shard_t des = _dispatch_epoll_mgr_shard;
+	bool registered = false;
+
+	for (uint32_t clock = 0; clock < DISPATCH_CLOCK_COUNT; clock++) {
+		dispatch_epoll_timeout_t timer = &dwt->dwt_timeout[clock];
+		// an armed timerfd holds a reference on the workloop
+		dispatch_assert(!timer->det_armed);
+		if (timer->det_registered) {
+			dispatch_assume_zero(epoll_ctl(des->des_epfd, EPOLL_CTL_DEL,
+					timer->det_fd, NULL));
+			registered = true;
+		}
+		if (timer->det_fd >= 0) {
+			close(timer->det_fd);
+		}
+	}
+
+	if (!registered) {
+		free(dwt);
+		return;
+	}
+	// the manager may still be looking at an event for one of the timerfds,
+	// let it free the memory, see _dispatch_event_loop_drain()
+	_dispatch_unfair_lock_lock(&des->des_lock);
+	LIST_INSERT_HEAD(&_dispatch_workloop_timers_disposed, dwt, dwt_list);
+	_dispatch_unfair_lock_unlock(&des->des_lock);
+}
+
+static void
+_dispatch_workloop_timers_free_disposed(void)
+{
+	dispatch_epoll_shard_t des = _dispatch_epoll_mgr_shard;
+	dispatch_workloop_timers_t dwt;
+
+	if (likely(!LIST_FIRST(&_dispatch_workloop_timers_disposed))) {
+		return;
+	}
+	_dispatch_unfair_lock_lock(&des->des_lock);
+	while ((dwt = LIST_FIRST(&_dispatch_workloop_timers_disposed))) {
+		LIST_REMOVE(dwt, dwt_list);
+		free(dwt);
+	}
+	_dispatch_unfair_lock_unlock(&des->des_lock);
+}
+
+static void
+_dispatch_workloop_timeout_program(dispatch_workloop_timers_t dwt,
+		uint32_t tidx, uint64_t target, uint64_t leeway)
+{
+	dispatch_clock_t clock = DISPATCH_TIMER_CLOCK(tidx);
+	dispatch_epoll_timeout_t timer = &dwt->dwt_timeout[clock];
+
+	target = _dispatch_timeout_update(timer, tidx, target, leeway);
+
+	if (target >= INT64_MAX) {
+		if (os_atomic_xchg2o(timer, det_armed, false, relaxed)) {
+			// the timerfd may still fire, which the manager will ignore
+			_dispatch_release(dwt->dwt_wlh);
+		}
+		timer->det_programmed = UINT64_MAX;
+		return;
+	}
+
+	if (unlikely(!timer->det_registered)) {
+		struct epoll_event ev = {
+			.events = EPOLLET | EPOLLIN,
+			.data = { .ptr = (void *)((uintptr_t)timer |
+					DISPATCH_EPOLL_WORKLOOP_TIMER) },
+		};
+
+		if (timer->det_fd < 0) {
+			timer->det_fd = _dispatch_timeout_create_fd(clock);
+			if (timer->det_fd < 0) {
+				return;
+			}
+		}
+		// make sure the manager shard exists and is being drained
+		_dispatch_event_loop_poke(DISPATCH_WLH_MANAGER, 0, 0);
+		if (dispatch_assume_zero(epoll_ctl(
+				_dispatch_epoll_mgr_shard->des_epfd, EPOLL_CTL_ADD,
+				timer->det_fd, &ev))) {
+			return;
+		}
+		timer->det_registered = true;
+	}
+
+	if (!os_atomic_load2o(timer, det_armed, relaxed)) {
+		_dispatch_retain(dwt->dwt_wlh);
+		os_atomic_store2o(timer, det_armed, true, release);
+	} else if (target == timer->det_programmed) {
+		// another bucket changed but the wakeup stays the same
+		return;
+	}
+	_dispatch_timeout_settime(timer, target);
+}
+
+static void
+_dispatch_workloop_timers_merge(void *ctxt)
+{
+	dispatch_workloop_timers_t dwt = ctxt;
+	dispatch_workloop_t dwl = dwt->dwt_wlh;
+	dispatch_timer_heap_t dth = dwt->dwt_heap;
+	uint32_t fired = os_atomic_xchg2o(dwt, dwt_fired, 0, acquire);
+
+	for (uint32_t clock = 0; clock < DISPATCH_CLOCK_COUNT; clock++) {
+		dispatch_epoll_timeout_t timer = &dwt->dwt_timeout[clock];
+		if (!(fired & (1u << clock))) {
+			continue;
+		}
+		// unlike for _dispatch_event_merge_timer(), buckets stay marked
+		// armed so that the ones which are now empty drop the timerfd
+		// if it was rearmed in the meantime
+		timer->det_programmed = UINT64_MAX;
+		for (uint32_t qos = 0; qos < DISPATCH_TIMER_QOS_COUNT; qos++) {
+			uint32_t tidx = DISPATCH_TIMER_INDEX(clock, qos);
+			timer->det_target[qos] = timer->det_deadline[qos] = UINT64_MAX;
+			_dispatch_timers_heap_dirty(dth, tidx);
+			dth[tidx].dth_needs_program = true;
+		}
+	}
+	if (dth[0].dth_dirty_bits) {
+		_dispatch_event_loop_drain_timers(dth, DISPATCH_TIMER_WLH_COUNT);
+	}
+	_dispatch_release_tailcall(dwl); // see _dispatch_event_merge_workloop_timer
+}
+
+static void
+_dispatch_event_merge_workloop_timer(dispatch_epoll_timeout_t timer)
+{
+	dispatch_workloop_timers_t dwt;
+
+	if (!os_atomic_xchg2o(timer, det_armed, false, acquire)) {
+		// the workloop disarmed this timerfd since it fired
+		return;
+	}
+	dwt = _dispatch_workloop_timers_from_timeout(timer);
+	os_atomic_or2o(dwt, dwt_fired, 1u << timer->det_ident, relaxed);
+	// consumes the reference held by the armed timerfd
+	dispatch_async_f(dwt->dwt_wlh->_as_dq, dwt,
+			_dispatch_workloop_timers_merge);
+}
+
+#endif // DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+
 void
 _dispatch_event_loop_timer_arm(dispatch_timer_heap_t dth, uint32_t tidx,
 		dispatch_timer_delay_s range, dispatch_clock_now_cache_t nows)
 {
 	dispatch_clock_t clock = DISPATCH_TIMER_CLOCK(tidx);
 	uint64_t target = range.delay + _dispatch_time_now_cached(clock, nows);
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+	if (dth != _dispatch_timers_heap) {
+		return _dispatch_workloop_timeout_program(
+				(dispatch_workloop_timers_t)dth, tidx, target, range.leeway);
+	}
+#endif
 	_dispatch_timeout_program(tidx, target, range.leeway);
 }
 
 void
 _dispatch_event_loop_timer_delete(dispatch_timer_heap_t dth, uint32_t tidx)
 {
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+	if (dth != _dispatch_timers_heap) {
+		return _dispatch_workloop_timeout_program(
+				(dispatch_workloop_timers_t)dth, tidx, UINT64_MAX, UINT64_MAX);
+	}
+#endif
 	_dispatch_timeout_program(tidx, UINT64_MAX, UINT64_MAX);
 }
 
@@ -450,17 +829,15 @@ _dispatch_event_loop_atfork_child(void)
 }
 
 static void
-_dispatch_epoll_init(void *context DISPATCH_UNUSED)
+_dispatch_epoll_shard_init(dispatch_epoll_shard_t des)
 {
-	_dispatch_fork_becomes_unsafe();
-
-	_dispatch_epfd = epoll_create1(EPOLL_CLOEXEC);
-	if (_dispatch_epfd < 0) {
+	des->des_epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (des->des_epfd < 0) {
 		DISPATCH_INTERNAL_CRASH(errno, "epoll_create1() failed");
 	}
 
-	_dispatch_eventfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
-	if (_dispatch_eventfd < 0) {
+	des->des_eventfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (des->des_eventfd < 0) {
 		DISPATCH_INTERNAL_CRASH(errno, "epoll_eventfd() failed");
 	}
 
@@ -469,9 +846,52 @@ _dispatch_epoll_init(void *context DISPATCH_UNUSED)
 		.data = { .u32 = DISPATCH_EPOLL_EVENTFD, },
 	};
 	int op = EPOLL_CTL_ADD;
-	if (epoll_ctl(_dispatch_epfd, op, _dispatch_eventfd, &ev) < 0) {
+	if (epoll_ctl(des->des_epfd, op, des->des_eventfd, &ev) < 0) {
 		DISPATCH_INTERNAL_CRASH(errno, "epoll_ctl() failed");
 	}
+	LIST_INIT(&des->des_disposed_head);
+}
+
+static void *_dispatch_epoll_shard_thread(void *context);
+
+static void
+_dispatch_epoll_init(void *context DISPATCH_UNUSED)
+{
+	pthread_attr_t attr;
+	pthread_t tid;
+	uint32_t i;
+	int r;
+
+	_dispatch_fork_becomes_unsafe();
+
+	char *e = getenv("LIBDISPATCH_EPOLL_SHARDS");
+	if (e) {
+		int n = atoi(e);
+		if (n > DISPATCH_EPOLL_MAX_SHARD_COUNT) {
+			n = DISPATCH_EPOLL_MAX_SHARD_COUNT;
+		}
+		if (n > 1) _dispatch_epoll_shard_count = (uint32_t)n;
+	}
+
+	for (i = 0; i < _dispatch_epoll_shard_count; i++) {
+		_dispatch_epoll_shard_init(&_dispatch_epoll_shards[i]);
+	}
+
+	if (_dispatch_epoll_shard_count > 1) {
+		dispatch_assume_zero(pthread_attr_init(&attr));
+		dispatch_assume_zero(pthread_attr_setdetachstate(&attr,
+				PTHREAD_CREATE_DETACHED));
+		for (i = 1; i < _dispatch_epoll_shard_count; i++) {
+			while ((r = pthread_create(&tid, &attr,
+					_dispatch_epoll_shard_thread, &_dispatch_epoll_shards[i]))) {
+				if (r != EAGAIN) {
+					(void)dispatch_assume_zero(r);
+				}
+				_dispatch_temporary_resource_shortage();
+			}
+		}
+		dispatch_assume_zero(pthread_attr_destroy(&attr));
+	}
 
 #if DISPATCH_USE_MGR_THREAD
 	_dispatch_trace_item_push(_dispatch_mgr_q.do_targetq, &_dispatch_mgr_q);
@@ -484,7 +904,8 @@ _dispatch_event_loop_poke(dispatch_wlh_t wlh DISPATCH_UNUSED,
 		uint64_t dq_state DISPATCH_UNUSED, uint32_t flags DISPATCH_UNUSED)
 {
 	dispatch_once_f(&epoll_init_pred, NULL, _dispatch_epoll_init);
-	dispatch_assume_zero(eventfd_write(_dispatch_eventfd, 1));
+	dispatch_assume_zero(eventfd_write(_dispatch_epoll_mgr_shard->des_eventfd,
+			1));
 }
 
 static void
@@ -517,46 +938,71 @@ _dispatch_event_merge_signal(dispatch_muxnote_t dmn)
 	}
 }
 
-static uintptr_t
-_dispatch_get_buffer_size(dispatch_muxnote_t dmn, bool writer)
+unsigned long
+_dispatch_unote_get_lazy_data(dispatch_unote_t du)
 {
+	dispatch_unote_linkage_t dul = _dispatch_unote_get_linkage(du);
+	dispatch_epoll_shard_t des;
+	bool writer = (du._du->du_filter == EVFILT_WRITE);
+	dispatch_muxnote_t dmn;
+	bool skip;
 	int n;
 
-	if (writer ? dmn->dmn_skip_outq_ioctl : dmn->dmn_skip_inq_ioctl) {
+	// Called by dispatch_source_get_data() instead of issuing the buffer size
+	// ioctl for every event merged, most handlers never look at this value.
+	//
+	// Whether the descriptor supports the ioctl is remembered by its muxnote,
+	// which is only accessed under the lock of its shard.
+	des = &_dispatch_epoll_shards[_dispatch_unote_shard(du)];
+	_dispatch_unfair_lock_lock(&des->des_lock);
+	dmn = dul->du_muxnote;
+	skip = !dmn || (writer ? dmn->dmn_skip_outq_ioctl :
+			dmn->dmn_skip_inq_ioctl);
+	_dispatch_unfair_lock_unlock(&des->des_lock);
+	if (skip) {
 		return 1;
 	}
 
-	if (ioctl((int)dmn->dmn_ident, writer ? SIOCOUTQ : SIOCINQ, &n) != 0) {
+	if (ioctl((int)du._du->du_ident, writer ? SIOCOUTQ : SIOCINQ, &n) != 0) {
 		switch (errno) {
 		case EINVAL:
 		case ENOTTY:
 			// this file descriptor actually doesn't support the buffer
-			// size ioctl, remember that for next time to avoid the syscall.
+			// size ioctl, remember that for next time
+			_dispatch_unfair_lock_lock(&des->des_lock);
+			if (dul->du_muxnote == dmn) {
+				if (writer) {
+					dmn->dmn_skip_outq_ioctl = true;
+				} else {
+					dmn->dmn_skip_inq_ioctl = true;
+				}
+			}
+			_dispatch_unfair_lock_unlock(&des->des_lock);
+			break;
+		case EBADF:
+			// the client closed the descriptor while still looking at
+			// the source data
 			break;
 		default:
 			dispatch_assume_zero(errno);
 			break;
 		}
-		if (writer) {
-			dmn->dmn_skip_outq_ioctl = true;
-		} else {
-			dmn->dmn_skip_inq_ioctl = true;
-		}
 		return 1;
 	}
-	return (uintptr_t)n;
+	return (unsigned long)n;
 }
 
 static void
 _dispatch_event_merge_fd(dispatch_muxnote_t dmn, uint32_t events)
 {
 	dispatch_unote_linkage_t dul, dul_next;
-	uintptr_t data;
+	// The actual buffer size is computed lazily by
+	// _dispatch_unote_get_lazy_data(), this only marks the source as ready
+	uintptr_t data = 1;
 
 	dmn->dmn_disarmed_events |= (events & (EPOLLIN | EPOLLOUT));
 
 	if (events & EPOLLIN) {
-		data = _dispatch_get_buffer_size(dmn, false);
 		LIST_FOREACH_SAFE(dul, &dmn->dmn_readers_head, du_link, dul_next) {
 			dispatch_unote_t du = _dispatch_unote_linkage_get_unote(dul);
 			// consumed by dux_merge_evt()
@@ -569,7 +1015,6 @@ _dispatch_event_merge_fd(dispatch_muxnote_t dmn, uint32_t events)
 	}
 
 	if (events & EPOLLOUT) {
-		data = _dispatch_get_buffer_size(dmn, true);
 		LIST_FOREACH_SAFE(dul, &dmn->dmn_writers_head, du_link, dul_next) {
 			dispatch_unote_t du = _dispatch_unote_linkage_get_unote(dul);
 			// consumed by dux_merge_evt()
@@ -585,16 +1030,15 @@ _dispatch_event_merge_fd(dispatch_muxnote_t dmn, uint32_t events)
 	if (events) _dispatch_epoll_update(dmn, events, EPOLL_CTL_MOD);
 }
 
-DISPATCH_NOINLINE
-void
-_dispatch_event_loop_drain(uint32_t flags)
+static int
+_dispatch_epoll_wait(dispatch_epoll_shard_t des, struct epoll_event *ev,
+		int count, int timeout)
 {
-	struct epoll_event ev[DISPATCH_EPOLL_MAX_EVENT_COUNT];
-	int i, r;
-	int timeout = (flags & KEVENT_FLAG_IMMEDIATE) ? 0 : -1;
+	int r;
 
 retry:
-	r = epoll_wait(_dispatch_epfd, ev, countof(ev), timeout);
+	r = epoll_wait(des->des_epfd, ev, count, timeout);
+	_dispatch_stats_inc(dispatch_stat_event_loop_wakeup);
 	if (unlikely(r == -1)) {
 		int err = errno;
 		switch (err) {
@@ -607,9 +1051,68 @@ retry:
 			(void)dispatch_assume_zero(err);
 			break;
 		}
-		return;
+		return 0;
+	}
+	return r;
+}
+
+static void
+_dispatch_epoll_shard_drain(dispatch_epoll_shard_t des)
+{
+	struct epoll_event ev[DISPATCH_EPOLL_MAX_EVENT_COUNT];
+	dispatch_muxnote_class_t dmnc;
+	eventfd_t value;
+	int i, r;
+
+	r = _dispatch_epoll_wait(des, ev, countof(ev), -1);
+
+	_dispatch_unfair_lock_lock(&des->des_lock);
+	for (i = 0; i < r; i++) {
+		if (ev[i].events & EPOLLFREE) {
+			DISPATCH_CLIENT_CRASH(0, "Do not close random Unix descriptors");
+		}
+
+		if (ev[i].data.u32 == DISPATCH_EPOLL_EVENTFD) {
+			dispatch_assume_zero(eventfd_read(des->des_eventfd, &value));
+		} else {
+			_dispatch_event_merge_fd(ev[i].data.ptr, ev[i].events);
+		}
 	}
 
+	// Muxnotes unregistered before this point can't be returned by the
+	// next epoll_wait() anymore
+	while ((dmnc = LIST_FIRST(&des->des_disposed_head))) {
+		LIST_REMOVE(dmnc, dmn_list);
+		_dispatch_muxnote_dispose((dispatch_muxnote_t)dmnc);
+	}
+	_dispatch_unfair_lock_unlock(&des->des_lock);
+}
+
+static void *
+_dispatch_epoll_shard_thread(void *context)
+{
+	dispatch_epoll_shard_t des = context;
+	dispatch_deferred_items_s ddi = {
+		.ddi_wlh = DISPATCH_WLH_ANON,
+	};
+
+	_dispatch_sigmask();
+	_dispatch_deferred_items_set(&ddi);
+	for (;;) {
+		_dispatch_epoll_shard_drain(des);
+	}
+}
+
+DISPATCH_NOINLINE
+void
+_dispatch_event_loop_drain(uint32_t flags)
+{
+	dispatch_epoll_shard_t des = _dispatch_epoll_mgr_shard;
+	struct epoll_event ev[DISPATCH_EPOLL_MAX_EVENT_COUNT];
+	int i, r;
+	int timeout = (flags & KEVENT_FLAG_IMMEDIATE) ? 0 : -1;
+
+	r = _dispatch_epoll_wait(des, ev, countof(ev), timeout);
 	for (i = 0; i < r; i++) {
 		dispatch_muxnote_t dmn;
 		eventfd_t value;
@@ -620,18 +1123,32 @@ retry:
 
 		switch (ev[i].data.u32) {
 		case DISPATCH_EPOLL_EVENTFD:
-			dispatch_assume_zero(eventfd_read(_dispatch_eventfd, &value));
+			dispatch_assume_zero(eventfd_read(des->des_eventfd, &value));
 			break;
 
 		case DISPATCH_EPOLL_CLOCK_WALL:
 			_dispatch_event_merge_timer(DISPATCH_CLOCK_WALL);
 			break;
 
-		case DISPATCH_EPOLL_CLOCK_MACH:
+		case DISPATCH_EPOLL_CLOCK_UPTIME:
 			_dispatch_event_merge_timer(DISPATCH_CLOCK_UPTIME);
 			break;
 
+		case DISPATCH_EPOLL_CLOCK_MONOTONIC:
+			_dispatch_event_merge_timer(DISPATCH_CLOCK_MONOTONIC);
+			break;
+
 		default:
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+			if (((uintptr_t)ev[i].data.ptr &
+					DISPATCH_EPOLL_WORKLOOP_TIMER_MASK) ==
+					DISPATCH_EPOLL_WORKLOOP_TIMER) {
+				_dispatch_event_merge_workloop_timer((void *)
+						((uintptr_t)ev[i].data.ptr &
+						~DISPATCH_EPOLL_WORKLOOP_TIMER_MASK));
+				break;
+			}
+#endif
 			dmn = ev[i].data.ptr;
 			switch (dmn->dmn_filter) {
 			case EVFILT_SIGNAL:
@@ -644,6 +1161,12 @@ retry:
 			}
 		}
 	}
+
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+	// Workloop timers disposed of before this point can't be returned by the
+	// next epoll_wait() anymore
+	_dispatch_workloop_timers_free_disposed();
+#endif
 }
 
 void
@@ -688,4 +1211,250 @@ _dispatch_event_loop_leave_immediate(uint64_t dq_state)
 	(void)dq_state;
 }
 
+#pragma mark -
+#pragma mark fd sets
+
+// The file descriptors of a DISPATCH_SOURCE_TYPE_FD_SET source live in a
+// private epoll set, and the source itself is a read unote on that epoll fd.
+
+#define DISPATCH_FD_SET_COPY_MAX 256
+
+int
+_dispatch_fd_set_poller_create(void)
+{
+	return epoll_create1(EPOLL_CLOEXEC);
+}
+
+int
+_dispatch_fd_set_poller_update(int pfd, int fd, uint32_t events)
+{
+	struct epoll_event ev = {
+		.data = { .fd = fd },
+	};
+
+	if (!events) {
+		return epoll_ctl(pfd, EPOLL_CTL_DEL, fd, NULL) < 0 ? errno : 0;
+	}
+	if (events & DISPATCH_FD_SET_READ) ev.events |= EPOLLIN | EPOLLRDHUP;
+	if (events & DISPATCH_FD_SET_WRITE) ev.events |= EPOLLOUT;
+
+	// adding is the common case, changing the events of a file descriptor
+	// already in the set costs a failed syscall
+	if (epoll_ctl(pfd, EPOLL_CTL_ADD, fd, &ev) == 0) {
+		return 0;
+	}
+	if (errno == EEXIST && epoll_ctl(pfd, EPOLL_CTL_MOD, fd, &ev) == 0) {
+		return 0;
+	}
+	return errno;
+}
+
+size_t
+_dispatch_fd_set_poller_copy(int pfd, dispatch_fd_event_s *events,
+		size_t count)
+{
+	struct epoll_event ev[DISPATCH_FD_SET_COPY_MAX];
+	int r;
+
+	do {
+		r = epoll_wait(pfd, ev, (int)MIN(count, countof(ev)), 0);
+	} while (unlikely(r < 0 && errno == EINTR));
+	if (unlikely(r < 0)) {
+		(void)dispatch_assume_zero(errno);
+		return 0;
+	}
+
+	for (int i = 0; i < r; i++) {
+		dispatch_fd_set_flags_t flags = 0;
+		if (ev[i].events & EPOLLIN) flags |= DISPATCH_FD_SET_READ;
+		if (ev[i].events & EPOLLOUT) flags |= DISPATCH_FD_SET_WRITE;
+		if (ev[i].events & (EPOLLHUP | EPOLLRDHUP)) {
+			flags |= DISPATCH_FD_SET_EOF;
+		}
+		if (ev[i].events & EPOLLERR) flags |= DISPATCH_FD_SET_ERROR;
+		events[i] = (dispatch_fd_event_s){
+			.fd = ev[i].data.fd,
+			.events = flags,
+		};
+	}
+	return (size_t)r;
+}
+
+#if DISPATCH_USE_SYNC_OWNER_BOOST
+#pragma mark -
+#pragma mark dispatch_sync owner boost
+
+// Linux has no equivalent to the QoS overrides the kernel applies to the
+// drainer of a queue a higher priority thread is blocked on, so a
+// dispatch_sync() waiter lends its nice value to the drain owner instead,
+// until the owner hands the queue over (see _dispatch_waiter_wake_wlh_anon).
+//
+// Several waiters may boost the same owner, so boosts are refcounted per
+// owner thread in a small table, and the owner's original nice value is only
+// restored when the last of them is done.
+
+#define DISPATCH_SYNC_BOOST_TABLE_SIZE	64
+#define DISPATCH_SYNC_BOOST_ENDED		((dispatch_tid)~0u)
+
+typedef struct dispatch_sync_boost_s {
+	dispatch_tid dsb_owner;
+	uint32_t dsb_refcnt;
+	int dsb_base_nice;
+	int dsb_nice;
+} dispatch_sync_boost_s, *dispatch_sync_boost_t;
+
+static dispatch_unfair_lock_s _dispatch_sync_boost_lock;
+static dispatch_sync_boost_s
+		_dispatch_sync_boost_table[DISPATCH_SYNC_BOOST_TABLE_SIZE];
+// Lowering the nice value of a thread requires CAP_SYS_NICE or a permissive
+// RLIMIT_NICE, when the process has neither every boost fails with EPERM and
+// the whole path is skipped once that was observed
+static bool _dispatch_sync_boost_unavailable;
+
+#if defined(SYS_sched_getattr) && defined(SYS_sched_setattr)
+// glibc doesn't wrap sched_{get,set}attr(2)
+struct dispatch_sched_attr_s {
+	uint32_t size;
+	uint32_t sched_policy;
+	uint64_t sched_flags;
+	int32_t  sched_nice;
+	uint32_t sched_priority;
+	uint64_t sched_runtime;
+	uint64_t sched_deadline;
+	uint64_t sched_period;
+};
+
+static bool
+_dispatch_thread_get_nice(dispatch_tid tid, int *nice)
+{
+	struct dispatch_sched_attr_s attr = { .size = sizeof(attr) };
+	if (syscall(SYS_sched_getattr, (pid_t)tid, &attr, sizeof(attr), 0)) {
+		return false;
+	}
+	if (attr.sched_policy != SCHED_OTHER && attr.sched_policy != SCHED_BATCH) {
+		// nice values are meaningless for realtime/idle policies
+		return false;
+	}
+	*nice = attr.sched_nice;
+	return true;
+}
+
+static bool
+_dispatch_thread_set_nice(dispatch_tid tid, int nice)
+{
+	struct dispatch_sched_attr_s attr = { .size = sizeof(attr) };
+	if (syscall(SYS_sched_getattr, (pid_t)tid, &attr, sizeof(attr), 0)) {
+		return false;
+	}
+	attr.sched_flags = 0;
+	attr.sched_nice = nice;
+	return syscall(SYS_sched_setattr, (pid_t)tid, &attr, 0) == 0;
+}
+#else
+static bool
+_dispatch_thread_get_nice(dispatch_tid tid, int *nice)
+{
+	errno = 0;
+	*nice = getpriority(PRIO_PROCESS, (id_t)tid);
+	return errno == 0;
+}
+
+static bool
+_dispatch_thread_set_nice(dispatch_tid tid, int nice)
+{
+	return setpriority(PRIO_PROCESS, (id_t)tid, nice) == 0;
+}
+#endif
+
+static void
+_dispatch_sync_boost_drop(dispatch_tid owner)
+{
+	_dispatch_unfair_lock_lock(&_dispatch_sync_boost_lock);
+	for (size_t i = 0; i < DISPATCH_SYNC_BOOST_TABLE_SIZE; i++) {
+		dispatch_sync_boost_t dsb = &_dispatch_sync_boost_table[i];
+		if (dsb->dsb_owner != owner) continue;
+		if (--dsb->dsb_refcnt == 0) {
+			(void)_dispatch_thread_set_nice(owner, dsb->dsb_base_nice);
+			dsb->dsb_owner = DLOCK_OWNER_NULL;
+		}
+		break;
+	}
+	_dispatch_unfair_lock_unlock(&_dispatch_sync_boost_lock);
+}
+
+void
+_dispatch_event_loop_boost_owner(dispatch_sync_context_t dsc,
+		uint64_t dq_state)
+{
+	dispatch_tid owner = _dq_state_drain_owner(dq_state);
+	dispatch_sync_boost_t dsb = NULL;
+	bool boosted = false;
+	int nice, owner_nice;
+
+	if (os_atomic_load(&_dispatch_sync_boost_unavailable, relaxed)) {
+		return;
+	}
+	if (owner == DLOCK_OWNER_NULL || owner == dsc->dsc_waiter) {
+		return;
+	}
+	if (!_dispatch_thread_get_nice(0, &nice) ||
+			!_dispatch_thread_get_nice(owner, &owner_nice) ||
+			nice >= owner_nice) {
+		// the owner already runs at least at our priority
+		return;
+	}
+
+	_dispatch_unfair_lock_lock(&_dispatch_sync_boost_lock);
+	for (size_t i = 0; i < DISPATCH_SYNC_BOOST_TABLE_SIZE; i++) {
+		dispatch_sync_boost_t it = &_dispatch_sync_boost_table[i];
+		if (it->dsb_owner == owner) {
+			dsb = it;
+			break;
+		}
+		if (!dsb && it->dsb_owner == DLOCK_OWNER_NULL) {
+			dsb = it;
+		}
+	}
+	if (unlikely(!dsb)) {
+		// too many boosted drainers at once, this is a best effort
+		goto out;
+	}
+	if (dsb->dsb_owner != owner) {
+		if (!_dispatch_thread_get_nice(owner, &dsb->dsb_base_nice)) {
+			goto out;
+		}
+		dsb->dsb_nice = dsb->dsb_base_nice;
+		dsb->dsb_refcnt = 0;
+	}
+	if (nice < dsb->dsb_nice) {
+		if (_dispatch_thread_set_nice(owner, nice)) {
+			dsb->dsb_owner = owner;
+			dsb->dsb_nice = nice;
+			dsb->dsb_refcnt++;
+			boosted = true;
+		} else if (errno == EPERM) {
+			os_atomic_store(&_dispatch_sync_boost_unavailable, true, relaxed);
+		}
+	}
+out:
+	_dispatch_unfair_lock_unlock(&_dispatch_sync_boost_lock);
+
+	if (boosted && !os_atomic_cmpxchg2o(dsc, dsc_boosted_owner,
+			DLOCK_OWNER_NULL, owner, relaxed)) {
+		// the owner reached us while we were boosting it
+		_dispatch_sync_boost_drop(owner);
+	}
+}
+
+void
+_dispatch_event_loop_end_boost(dispatch_sync_context_t dsc)
+{
+	dispatch_tid owner = os_atomic_xchg2o(dsc, dsc_boosted_owner,
+			DISPATCH_SYNC_BOOST_ENDED, relaxed);
+	if (unlikely(owner != DLOCK_OWNER_NULL)) {
+		_dispatch_sync_boost_drop(owner);
+	}
+}
+#endif // DISPATCH_USE_SYNC_OWNER_BOOST
+
 #endif // DISPATCH_EVENT_BACKEND_EPOLL
@@ -136,13 +136,14 @@ _dispatch_timer_flags_from_clock(dispatch_clock_t clock)
 	uint8_t   du_vmpressure_override : 1; \
 	uint8_t   du_can_be_wlh : 1; \
 	uint8_t   dmrr_handler_is_block : 1; \
-	uint8_t   du_unused_flag : 1; \
+	uint8_t   du_data_is_lazy : 1; \
 	union { \
 		uint8_t   du_timer_flags; \
 		os_atomic(bool) dmsr_notification_armed; \
 		bool dmr_reply_port_owned; \
 	}; \
-	uint8_t   du_unused; \
+	uint8_t   du_is_inline : 1; /* co-allocated with its source */ \
+	uint8_t   du_unused : 7; \
 	uint32_t  du_fflags; \
 	dispatch_priority_t du_priority
 
@@ -183,10 +184,25 @@ enum {
 
 // Source state which may contain references to the source object
 // Separately allocated so that 'leaks' can see sources <rdar://problem/9050566>
+// unless DISPATCH_USE_INLINE_SOURCE_REFS co-allocates them with the source
 typedef struct dispatch_source_refs_s {
 	DISPATCH_SOURCE_REFS_HEADER();
 } *dispatch_source_refs_t;
 
+// Refs of DISPATCH_SOURCE_TYPE_DATA_VECTOR sources: pointers merged with
+// dispatch_source_merge_pointer() are pushed on the dsv_items MPSC list, and
+// ds_pending_data counts them so that only the first merge after the source
+// latched its data needs to wake it up. The latch moves the items to the
+// batch that dispatch_source_copy_pointers() consumes.
+typedef struct dispatch_source_vector_refs_s {
+	DISPATCH_SOURCE_REFS_HEADER();
+	struct dispatch_continuation_s *volatile dsv_items_head;
+	struct dispatch_continuation_s *volatile dsv_items_tail;
+	struct dispatch_continuation_s *dsv_batch_head;
+	struct dispatch_continuation_s *dsv_batch_tail;
+	uint64_t dsv_batch_count;
+} *dispatch_source_vector_refs_t;
+
 typedef struct dispatch_timer_delay_s {
 	uint64_t delay, leeway;
 } dispatch_timer_delay_s;
@@ -219,6 +235,21 @@ typedef struct dispatch_timer_source_refs_s {
 	uint32_t dt_heap_entry[DTH_ID_COUNT];
 } *dispatch_timer_source_refs_t;
 
+// dispatch_after() timers aren't backed by a dispatch source: the manager
+// arms them directly in the anonymous timer heap, and when they fire their
+// continuation is pushed on `dar_queue` and the entry is freed.
+typedef struct dispatch_after_refs_s {
+	struct dispatch_timer_source_refs_s dar_timer;
+	struct dispatch_after_refs_s *volatile dar_next;
+	dispatch_queue_t dar_queue;
+} *dispatch_after_refs_t;
+
+// dispatch_after() timers waiting for the manager to arm them
+typedef struct dispatch_after_pending_s {
+	struct dispatch_after_refs_s *volatile dap_head;
+	struct dispatch_after_refs_s *volatile dap_tail;
+} dispatch_after_pending_s;
+
 typedef struct dispatch_timer_heap_s {
 	uint32_t dth_count;
 	uint8_t dth_segments;
@@ -304,6 +335,7 @@ typedef union dispatch_unote_u {
 	dispatch_unote_class_t _du;
 	dispatch_source_refs_t _dr;
 	dispatch_timer_source_refs_t _dt;
+	dispatch_source_vector_refs_t _dsv;
 #if HAVE_MACH
 	dispatch_mach_recv_refs_t _dmrr;
 	dispatch_mach_send_refs_t _dmsr;
@@ -315,11 +347,51 @@ typedef union dispatch_unote_u {
 #define DISPATCH_UNOTE_NULL ((dispatch_unote_t){ ._du = NULL })
 
 #if TARGET_OS_IPHONE
-#define DSL_HASH_SIZE  64u // must be a power of two
+#define DISPATCH_MUXNOTE_TABLE_MIN_SIZE  64u // must be a power of two
 #else
-#define DSL_HASH_SIZE 256u // must be a power of two
+#define DISPATCH_MUXNOTE_TABLE_MIN_SIZE 256u // must be a power of two
 #endif
-#define DSL_HASH(x) ((x) & (DSL_HASH_SIZE - 1))
+
+// Common prefix of the backend specific struct dispatch_muxnote_s
+#define DISPATCH_MUXNOTE_CLASS_HEADER() \
+	LIST_ENTRY(dispatch_muxnote_class_s) dmn_list; \
+	uint32_t  dmn_hash
+
+typedef struct dispatch_muxnote_class_s {
+	DISPATCH_MUXNOTE_CLASS_HEADER();
+} *dispatch_muxnote_class_t;
+
+LIST_HEAD(dispatch_muxnote_bucket_s, dispatch_muxnote_class_s);
+
+/*
+ * Muxnotes are kept in a chained hash table keyed by a small integer (fd,
+ * signal number, pid or port index) that doubles in size whenever it holds
+ * more muxnotes than buckets, so that lookups stay short no matter how many
+ * descriptors are registered.
+ *
+ * The table is only ever accessed from the synchronization context that
+ * registers muxed unotes.
+ */
+typedef struct dispatch_muxnote_table_s {
+	struct dispatch_muxnote_bucket_s *dmt_buckets;
+	uint32_t dmt_mask;
+	uint32_t dmt_count;
+} *dispatch_muxnote_table_t;
+
+DISPATCH_ALWAYS_INLINE
+static inline struct dispatch_muxnote_bucket_s *
+_dispatch_muxnote_table_bucket(dispatch_muxnote_table_t dmt, uint32_t hash)
+{
+	if (unlikely(!dmt->dmt_buckets)) {
+		return NULL;
+	}
+	return &dmt->dmt_buckets[hash & dmt->dmt_mask];
+}
+
+void _dispatch_muxnote_table_insert(dispatch_muxnote_table_t dmt,
+		dispatch_muxnote_class_t dmn, uint32_t hash);
+void _dispatch_muxnote_table_remove(dispatch_muxnote_table_t dmt,
+		dispatch_muxnote_class_t dmn);
 
 typedef struct dispatch_unote_linkage_s {
 	LIST_ENTRY(dispatch_unote_linkage_s) du_link;
@@ -370,7 +442,6 @@ typedef struct dispatch_source_type_s {
 #define dux_merge_evt(du, ...) dux_type(du)->dst_merge_evt(du, __VA_ARGS__)
 #define dux_merge_msg(du, ...) dux_type(du)->dst_merge_msg(du, __VA_ARGS__)
 
-extern const dispatch_source_type_s _dispatch_source_type_after;
 
 #if HAVE_MACH
 extern const dispatch_source_type_s _dispatch_mach_type_notification;
@@ -601,9 +672,14 @@ _dispatch_timer_unote_compute_missed(dispatch_timer_source_refs_t dt,
 #define DISPATCH_TIMER_INDEX(clock, qos) (((clock) * DISPATCH_TIMER_QOS_COUNT) + (qos))
 #define DISPATCH_TIMER_COUNT \
 		DISPATCH_TIMER_INDEX(DISPATCH_CLOCK_COUNT, 0)
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+// Workloop timers have a timerfd per clock, WALL included
+#define DISPATCH_TIMER_WLH_COUNT DISPATCH_TIMER_COUNT
+#else
 // Workloops do not support optimizing WALL timers
 #define DISPATCH_TIMER_WLH_COUNT \
 		DISPATCH_TIMER_INDEX(DISPATCH_CLOCK_WALL, 0)
+#endif
 
 #define DISPATCH_TIMER_IDENT_CANCELED    (~0u)
 
@@ -666,6 +742,11 @@ void _dispatch_event_loop_wait_for_ownership(
 		struct dispatch_sync_context_s *dsc);
 void _dispatch_event_loop_end_ownership(dispatch_wlh_t wlh,
 		uint64_t old_state, uint64_t new_state, uint32_t flags);
+#if DISPATCH_USE_SYNC_OWNER_BOOST
+void _dispatch_event_loop_boost_owner(struct dispatch_sync_context_s *dsc,
+		uint64_t dq_state);
+void _dispatch_event_loop_end_boost(struct dispatch_sync_context_s *dsc);
+#endif
 #if DISPATCH_WLH_DEBUG
 void _dispatch_event_loop_assert_not_owned(dispatch_wlh_t wlh);
 #else
@@ -679,6 +760,14 @@ void _dispatch_event_loop_leave_deferred(dispatch_deferred_items_t ddi,
 void _dispatch_event_loop_merge(dispatch_kevent_t events, int nevents);
 #endif
 void _dispatch_event_loop_drain(uint32_t flags);
+#if DISPATCH_EVENT_BACKEND_EPOLL
+unsigned long _dispatch_unote_get_lazy_data(dispatch_unote_t du);
+#endif
+
+int _dispatch_fd_set_poller_create(void);
+int _dispatch_fd_set_poller_update(int pfd, int fd, uint32_t events);
+size_t _dispatch_fd_set_poller_copy(int pfd, dispatch_fd_event_s *events,
+		size_t count);
 
 void _dispatch_event_loop_timer_arm(dispatch_timer_heap_t dth, uint32_t tidx,
 		dispatch_timer_delay_s range, dispatch_clock_now_cache_t nows);
@@ -686,6 +775,16 @@ void _dispatch_event_loop_timer_delete(dispatch_timer_heap_t dth, uint32_t tidx)
 
 void _dispatch_event_loop_drain_timers(dispatch_timer_heap_t dth, uint32_t count);
 
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+dispatch_timer_heap_t _dispatch_event_loop_workloop_timer_heap(
+		dispatch_workloop_t dwl);
+void _dispatch_event_loop_workloop_timer_heap_dispose(dispatch_timer_heap_t dth);
+#endif
+
+extern dispatch_after_pending_s _dispatch_after_pending;
+void _dispatch_after_timer_enqueue(dispatch_after_refs_t dar);
+void _dispatch_after_timers_arm_pending(void);
+
 DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_timers_heap_dirty(dispatch_timer_heap_t dth, uint32_t tidx)
@@ -698,6 +797,9 @@ DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_event_loop_drain_anon_timers(void)
 {
+	if (os_atomic_load2o(&_dispatch_after_pending, dap_tail, relaxed)) {
+		_dispatch_after_timers_arm_pending();
+	}
 	if (_dispatch_timers_heap[0].dth_dirty_bits) {
 		_dispatch_event_loop_drain_timers(_dispatch_timers_heap,
 				DISPATCH_TIMER_COUNT);
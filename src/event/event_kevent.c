@@ -33,16 +33,14 @@
 #define DISPATCH_MACH_AUDIT_TOKEN_PID (5)
 
 typedef struct dispatch_muxnote_s {
-	LIST_ENTRY(dispatch_muxnote_s) dmn_list;
+	DISPATCH_MUXNOTE_CLASS_HEADER();
 	LIST_HEAD(, dispatch_unote_linkage_s) dmn_unotes_head;
 	dispatch_kevent_s dmn_kev DISPATCH_ATOMIC64_ALIGN;
 } *dispatch_muxnote_t;
 
-LIST_HEAD(dispatch_muxnote_bucket_s, dispatch_muxnote_s);
-
 DISPATCH_STATIC_GLOBAL(bool _dispatch_timers_force_max_leeway);
 DISPATCH_STATIC_GLOBAL(dispatch_once_t _dispatch_kq_poll_pred);
-DISPATCH_STATIC_GLOBAL(struct dispatch_muxnote_bucket_s _dispatch_sources[DSL_HASH_SIZE]);
+DISPATCH_STATIC_GLOBAL(struct dispatch_muxnote_table_s _dispatch_sources);
 
 #define DISPATCH_NOTE_CLOCK_WALL      NOTE_NSECONDS | NOTE_MACH_CONTINUOUS_TIME
 #define DISPATCH_NOTE_CLOCK_MONOTONIC NOTE_MACHTIME | NOTE_MACH_CONTINUOUS_TIME
@@ -105,6 +103,7 @@ _evfiltstr(short filt)
 	_evfilt2(DISPATCH_EVFILT_CUSTOM_ADD);
 	_evfilt2(DISPATCH_EVFILT_CUSTOM_OR);
 	_evfilt2(DISPATCH_EVFILT_CUSTOM_REPLACE);
+	_evfilt2(DISPATCH_EVFILT_CUSTOM_VECTOR);
 	default:
 		return "EVFILT_missing";
 	}
@@ -960,8 +959,8 @@ done:
 #pragma mark dispatch_muxnote_t
 
 DISPATCH_ALWAYS_INLINE
-static inline struct dispatch_muxnote_bucket_s *
-_dispatch_muxnote_bucket(uint64_t ident, int16_t filter)
+static inline uint32_t
+_dispatch_muxnote_hash(uint64_t ident, int16_t filter)
 {
 	switch (filter) {
 #if HAVE_MACH
@@ -976,42 +975,44 @@ _dispatch_muxnote_bucket(uint64_t ident, int16_t filter)
 		break;
 	}
 
-	return &_dispatch_sources[DSL_HASH((uintptr_t)ident)];
+	return (uint32_t)ident;
 }
-#define _dispatch_unote_muxnote_bucket(du) \
-	_dispatch_muxnote_bucket(du._du->du_ident, du._du->du_filter)
 
 DISPATCH_ALWAYS_INLINE
 static inline dispatch_muxnote_t
-_dispatch_muxnote_find(struct dispatch_muxnote_bucket_s *dmb,
-		uint64_t ident, int16_t filter)
+_dispatch_muxnote_find(uint64_t ident, int16_t filter)
 {
-	dispatch_muxnote_t dmn;
-	LIST_FOREACH(dmn, dmb, dmn_list) {
+	struct dispatch_muxnote_bucket_s *dmb;
+	dispatch_muxnote_class_t dmnc;
+
+	dmb = _dispatch_muxnote_table_bucket(&_dispatch_sources,
+			_dispatch_muxnote_hash(ident, filter));
+	if (unlikely(!dmb)) {
+		return NULL;
+	}
+	LIST_FOREACH(dmnc, dmb, dmn_list) {
+		dispatch_muxnote_t dmn = (dispatch_muxnote_t)dmnc;
 		if (dmn->dmn_kev.ident == ident && dmn->dmn_kev.filter == filter) {
-			break;
+			return dmn;
 		}
 	}
-	return dmn;
+	return NULL;
 }
 
 DISPATCH_ALWAYS_INLINE
 static inline dispatch_muxnote_t
 _dispatch_mach_muxnote_find(mach_port_t name, int16_t filter)
 {
-	struct dispatch_muxnote_bucket_s *dmb;
-	dmb = _dispatch_muxnote_bucket(name, filter);
-	return _dispatch_muxnote_find(dmb, name, filter);
+	return _dispatch_muxnote_find(name, filter);
 }
 
 bool
 _dispatch_unote_register_muxed(dispatch_unote_t du)
 {
-	struct dispatch_muxnote_bucket_s *dmb = _dispatch_unote_muxnote_bucket(du);
 	dispatch_muxnote_t dmn;
 	bool installed = true;
 
-	dmn = _dispatch_muxnote_find(dmb, du._du->du_ident, du._du->du_filter);
+	dmn = _dispatch_muxnote_find(du._du->du_ident, du._du->du_filter);
 	if (dmn) {
 		uint32_t flags = du._du->du_fflags & ~dmn->dmn_kev.fflags;
 		if (flags) {
@@ -1039,7 +1040,10 @@ _dispatch_unote_register_muxed(dispatch_unote_t du)
 		}
 		if (installed) {
 			dmn->dmn_kev.flags &= ~(EV_ADD | EV_VANISHED);
-			LIST_INSERT_HEAD(dmb, dmn, dmn_list);
+			uint32_t hash = _dispatch_muxnote_hash(du._du->du_ident,
+					du._du->du_filter);
+			_dispatch_muxnote_table_insert(&_dispatch_sources,
+					(dispatch_muxnote_class_t)dmn, hash);
 		} else {
 			free(dmn);
 		}
@@ -1111,7 +1115,8 @@ _dispatch_unote_unregister_muxed(dispatch_unote_t du)
 		}
 	}
 	if (dispose) {
-		LIST_REMOVE(dmn, dmn_list);
+		_dispatch_muxnote_table_remove(&_dispatch_sources,
+				(dispatch_muxnote_class_t)dmn);
 		free(dmn);
 	}
 	_dispatch_du_debug("deleted", du._du);
@@ -1687,6 +1692,78 @@ const dispatch_source_type_s _dispatch_source_type_vm = {
 };
 #endif // DISPATCH_USE_MEMORYSTATUS
 
+#pragma mark fd sets
+
+// The file descriptors of a DISPATCH_SOURCE_TYPE_FD_SET source live in a
+// private kqueue, and the source itself is a read unote on that kqueue.
+
+#define DISPATCH_FD_SET_COPY_MAX 256
+
+int
+_dispatch_fd_set_poller_create(void)
+{
+	int kqfd = kqueue();
+	if (kqfd >= 0) {
+		(void)dispatch_assume_zero(fcntl(kqfd, F_SETFD, FD_CLOEXEC));
+	}
+	return kqfd;
+}
+
+int
+_dispatch_fd_set_poller_update(int pfd, int fd, uint32_t events)
+{
+	struct kevent ke[2];
+	int r;
+
+	EV_SET(&ke[0], fd, EVFILT_READ, (events & DISPATCH_FD_SET_READ) ?
+			EV_ADD|EV_ENABLE|EV_RECEIPT : EV_DELETE|EV_RECEIPT, 0, 0, NULL);
+	EV_SET(&ke[1], fd, EVFILT_WRITE, (events & DISPATCH_FD_SET_WRITE) ?
+			EV_ADD|EV_ENABLE|EV_RECEIPT : EV_DELETE|EV_RECEIPT, 0, 0, NULL);
+	r = kevent(pfd, ke, 2, ke, 2, NULL);
+	if (unlikely(r < 0)) {
+		return errno;
+	}
+	for (int i = 0; i < r; i++) {
+		// deleting a filter that wasn't registered is not an error
+		if ((ke[i].flags & EV_ERROR) && ke[i].data &&
+				ke[i].data != ENOENT) {
+			return (int)ke[i].data;
+		}
+	}
+	return 0;
+}
+
+size_t
+_dispatch_fd_set_poller_copy(int pfd, dispatch_fd_event_s *events,
+		size_t count)
+{
+	const struct timespec timeout_immediately = {};
+	struct kevent ke[DISPATCH_FD_SET_COPY_MAX];
+	int r;
+
+	do {
+		r = kevent(pfd, NULL, 0, ke, (int)MIN(count, countof(ke)),
+				&timeout_immediately);
+	} while (unlikely(r < 0 && errno == EINTR));
+	if (unlikely(r < 0)) {
+		(void)dispatch_assume_zero(errno);
+		return 0;
+	}
+
+	for (int i = 0; i < r; i++) {
+		dispatch_fd_set_flags_t flags = 0;
+		if (ke[i].filter == EVFILT_READ) flags |= DISPATCH_FD_SET_READ;
+		if (ke[i].filter == EVFILT_WRITE) flags |= DISPATCH_FD_SET_WRITE;
+		if (ke[i].flags & EV_EOF) flags |= DISPATCH_FD_SET_EOF;
+		if (ke[i].flags & EV_ERROR) flags |= DISPATCH_FD_SET_ERROR;
+		events[i] = (dispatch_fd_event_s){
+			.fd = (dispatch_fd_t)ke[i].ident,
+			.events = flags,
+		};
+	}
+	return (size_t)r;
+}
+
 #pragma mark mach send / notifications
 #if HAVE_MACH
 
@@ -39,6 +39,10 @@
  * number of runnable workers is below the target size for the pool,
  * and (iii) the total number of worker threads is below an upper limit,
  * then an additional worker thread will be added to the pool.
+ *
+ * Conversely, if more workers than the target size are runnable, the excess
+ * is reported to the narrowing checks of the drainers so that they give their
+ * thread back.
  */
 
 #pragma mark static data for monitoring subsystem
@@ -56,6 +60,12 @@ typedef struct dispatch_workq_monitor_s {
 	/* The desired number of runnable worker threads */
 	int32_t target_runnable;
 
+	/*
+	 * The number of workers that should still give their thread back,
+	 * replenished by every monitoring pass, see _dispatch_workq_should_narrow()
+	 */
+	os_atomic(int32_t) num_excess;
+
 	/*
 	 * Tracking of registered workers; all accesses must hold lock.
 	 * Invariant: registered_tids[0]...registered_tids[num_registered_tids-1]
@@ -120,8 +130,30 @@ _dispatch_workq_worker_unregister(dispatch_queue_global_t root_q)
 #endif // HAVE_DISPATCH_WORKQ_MONITORING
 }
 
-
 #if HAVE_DISPATCH_WORKQ_MONITORING
+/*
+ * User-space equivalent of _pthread_workqueue_should_narrow(): the monitor
+ * records how many runnable workers exceed the target for each pool, and
+ * that many drainers are told to narrow at their next narrowing checkpoint.
+ */
+bool
+_dispatch_workq_should_narrow(dispatch_queue_global_t root_q)
+{
+	dispatch_qos_t qos = _dispatch_priority_qos(root_q->dq_priority);
+	if (qos == 0) qos = DISPATCH_QOS_DEFAULT;
+	int bucket = DISPATCH_QOS_BUCKET(qos);
+	dispatch_workq_monitor_t mon = &_dispatch_workq_monitors[bucket];
+	int32_t old_excess, new_excess;
+
+	return os_atomic_rmw_loop(&mon->num_excess, old_excess, new_excess,
+			relaxed, {
+		if (old_excess <= 0) {
+			os_atomic_rmw_loop_give_up(return false);
+		}
+		new_excess = old_excess - 1;
+	});
+}
+
 #if defined(__linux__)
 /*
  * For each pid that is a registered worker, read /proc/[pid]/stat
@@ -193,6 +225,7 @@ _dispatch_workq_monitor_pools(void *context DISPATCH_UNUSED)
 
 		if (!_dispatch_queue_class_probe(dq)) {
 			_dispatch_debug("workq: %s is empty.", dq->dq_label);
+			os_atomic_store(&mon->num_excess, 0, relaxed);
 			continue;
 		}
 
@@ -202,6 +235,11 @@ _dispatch_workq_monitor_pools(void *context DISPATCH_UNUSED)
 
 		global_runnable += mon->num_runnable;
 
+		// After a blocking burst, more workers than the target may have
+		// become runnable again, let the excess narrow
+		os_atomic_store(&mon->num_excess,
+				MAX(mon->num_runnable - mon->target_runnable, 0), relaxed);
+
 		if (mon->num_runnable == 0) {
 			// We have work, but no worker is runnable.
 			// It is likely the program is stalled. Therefore treat
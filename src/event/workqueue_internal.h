@@ -36,5 +36,9 @@ void _dispatch_workq_worker_unregister(dispatch_queue_global_t root_q);
 #define HAVE_DISPATCH_WORKQ_MONITORING 0
 #endif
 
+#if HAVE_DISPATCH_WORKQ_MONITORING
+bool _dispatch_workq_should_narrow(dispatch_queue_global_t root_q);
+#endif
+
 #endif /* __DISPATCH_WORKQUEUE_INTERNAL__ */
 
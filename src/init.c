@@ -110,9 +110,28 @@ void *(*_dispatch_begin_NSAutoReleasePool)(void);
 void (*_dispatch_end_NSAutoReleasePool)(void *);
 #endif
 
+#if DISPATCH_USE_SDT
+#define DISPATCH_SDT_SEMAPHORE_DEFINE(name) \
+		volatile unsigned short DISPATCH_SDT_SEMAPHORE(name) \
+		__attribute__((__section__(".probes"), __visibility__("hidden")))
+DISPATCH_SDT_SEMAPHORE_DEFINE(queue__push);
+DISPATCH_SDT_SEMAPHORE_DEFINE(queue__pop);
+DISPATCH_SDT_SEMAPHORE_DEFINE(callout__entry);
+DISPATCH_SDT_SEMAPHORE_DEFINE(callout__return);
+DISPATCH_SDT_SEMAPHORE_DEFINE(timer__configure);
+DISPATCH_SDT_SEMAPHORE_DEFINE(timer__program);
+DISPATCH_SDT_SEMAPHORE_DEFINE(timer__wake);
+DISPATCH_SDT_SEMAPHORE_DEFINE(timer__fire);
+DISPATCH_SDT_SEMAPHORE_DEFINE(after__fire);
+DISPATCH_SDT_SEMAPHORE_DEFINE(runtime__event);
+#endif // DISPATCH_USE_SDT
+
 #if DISPATCH_USE_THREAD_LOCAL_STORAGE
 __thread struct dispatch_tsd __dispatch_tsd;
 pthread_key_t __dispatch_tsd_key;
+#if DISPATCH_USE_THREAD_STATS
+__thread struct dispatch_thread_stats_s __dispatch_thread_stats;
+#endif
 #elif !DISPATCH_USE_DIRECT_TSD
 pthread_key_t dispatch_queue_key;
 pthread_key_t dispatch_frame_key;
@@ -450,6 +469,10 @@ _dispatch_queue_attr_to_info(dispatch_queue_attr_t dqa)
 	dqai.dqai_overcommit = idx % DISPATCH_QUEUE_ATTR_OVERCOMMIT_COUNT;
 	idx /= DISPATCH_QUEUE_ATTR_OVERCOMMIT_COUNT;
 
+	dqai.dqai_latency_tracking =
+			idx % DISPATCH_QUEUE_ATTR_LATENCY_TRACKING_COUNT;
+	idx /= DISPATCH_QUEUE_ATTR_LATENCY_TRACKING_COUNT;
+
 	return dqai;
 }
 
@@ -458,6 +481,9 @@ _dispatch_queue_attr_from_info(dispatch_queue_attr_info_t dqai)
 {
 	size_t idx = 0;
 
+	idx *= DISPATCH_QUEUE_ATTR_LATENCY_TRACKING_COUNT;
+	idx += dqai.dqai_latency_tracking;
+
 	idx *= DISPATCH_QUEUE_ATTR_OVERCOMMIT_COUNT;
 	idx += dqai.dqai_overcommit;
 
@@ -530,6 +556,14 @@ dispatch_queue_attr_make_with_autorelease_frequency(dispatch_queue_attr_t dqa,
 	return _dispatch_queue_attr_from_info(dqai);
 }
 
+dispatch_queue_attr_t
+dispatch_queue_attr_make_with_latency_tracking(dispatch_queue_attr_t dqa)
+{
+	dispatch_queue_attr_info_t dqai = _dispatch_queue_attr_to_info(dqa);
+	dqai.dqai_latency_tracking = true;
+	return _dispatch_queue_attr_from_info(dqai);
+}
+
 #pragma mark -
 #pragma mark dispatch_vtables
 
@@ -622,6 +656,20 @@ DISPATCH_VTABLE_INSTANCE(disk,
 	.do_invoke      = _dispatch_object_no_invoke,
 );
 
+DISPATCH_VTABLE_INSTANCE(channel,
+	.do_type        = DISPATCH_CHANNEL_TYPE,
+	.do_dispose     = _dispatch_channel_dispose,
+	.do_debug       = _dispatch_channel_debug,
+	.do_invoke      = _dispatch_object_no_invoke,
+);
+
+DISPATCH_VTABLE_INSTANCE(strand,
+	.do_type        = DISPATCH_STRAND_TYPE,
+	.do_dispose     = _dispatch_strand_dispose,
+	.do_debug       = _dispatch_strand_debug,
+	.do_invoke      = _dispatch_strand_invoke,
+);
+
 /*
  * Dispatch queue cluster
  */
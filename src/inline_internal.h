@@ -1709,12 +1709,30 @@ _dispatch_queue_push_item(dispatch_lane_class_t dqu, dispatch_object_t dou)
 	return os_mpsc_push_item(os_mpsc(dqu._dl, dq_items), dou._do, do_next);
 }
 
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_root_queue_stats_add(dispatch_queue_global_t dq,
+		dispatch_stat_t stat, int n)
+{
+#if DISPATCH_USE_THREAD_STATS
+	size_t idx = ((uintptr_t)dq - (uintptr_t)_dispatch_root_queues) /
+			sizeof(struct dispatch_queue_global_s);
+	// pthread root queues aren't accounted for
+	if (likely(idx < DISPATCH_STATS_ROOT_QUEUE_COUNT)) {
+		_dispatch_stats_add((dispatch_stat_t)(stat + idx), (unsigned long)n);
+	}
+#else
+	(void)dq; (void)stat; (void)n;
+#endif
+}
+
 DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_root_queue_push_inline(dispatch_queue_global_t dq,
 		dispatch_object_t _head, dispatch_object_t _tail, int n)
 {
 	struct dispatch_object_s *hd = _head._do, *tl = _tail._do;
+	_dispatch_root_queue_stats_add(dq, dispatch_stat_enqueued, n);
 	if (unlikely(os_mpsc_push_list(os_mpsc(dq, dq_items), hd, tl, do_next))) {
 		return _dispatch_root_queue_poke(dq, n, 0);
 	}
@@ -2373,8 +2391,10 @@ _dispatch_continuation_alloc(void)
 	dispatch_continuation_t dc =
 			_dispatch_continuation_alloc_cacheonly();
 	if (unlikely(!dc)) {
+		_dispatch_stats_inc(dispatch_stat_cache_miss);
 		return _dispatch_continuation_alloc_from_heap();
 	}
+	_dispatch_stats_inc(dispatch_stat_cache_hit);
 	return dc;
 }
 
@@ -2433,6 +2453,13 @@ _dispatch_continuation_invoke_inline(dispatch_object_t dou,
 	dispatch_continuation_t dc = dou._dc, dc1;
 	dispatch_invoke_with_autoreleasepool(flags, {
 		uintptr_t dc_flags = dc->dc_flags;
+#if DISPATCH_USE_QUEUE_LATENCY_TRACKING
+		uint64_t enqueue_time = 0, start_time = 0;
+		if (unlikely(dc_flags & DC_FLAG_LATENCY_STAMP)) {
+			enqueue_time = (uint64_t)(uintptr_t)dc->dc_other;
+			start_time = _dispatch_uptime();
+		}
+#endif
 		// Add the item back to the cache before calling the function. This
 		// allows the 'hot' continuation to be used for a quick callback.
 		//
@@ -2454,6 +2481,11 @@ _dispatch_continuation_invoke_inline(dispatch_object_t dou,
 			_dispatch_client_callout(dc->dc_ctxt, dc->dc_func);
 			_dispatch_trace_item_complete(dc);
 		}
+#if DISPATCH_USE_QUEUE_LATENCY_TRACKING
+		if (unlikely(start_time)) {
+			_dispatch_queue_latency_record(dqu, enqueue_time, start_time);
+		}
+#endif
 		if (unlikely(dc1)) {
 			_dispatch_continuation_free_to_cache_limit(dc1);
 		}
@@ -2548,10 +2580,34 @@ _dispatch_continuation_init_f(dispatch_continuation_t dc,
 	if (!(flags & DISPATCH_BLOCK_HAS_PRIORITY)) {
 		pp = _dispatch_priority_propagate();
 	}
+#if DISPATCH_USE_QUEUE_LATENCY_TRACKING
+	// only asynchronous work items can be stamped as they leave dc_other alone
+	if (unlikely(_dispatch_queue_atomic_flags(dqu) & DQF_LATENCY_TRACKING) &&
+			(dc_flags & DC_FLAG_CONSUME)) {
+		dc->dc_flags |= DC_FLAG_LATENCY_STAMP;
+		dc->dc_other = (void *)(uintptr_t)_dispatch_uptime();
+	}
+#endif
 	_dispatch_continuation_voucher_set(dc, flags);
 	return _dispatch_continuation_priority_set(dc, dqu, pp, flags);
 }
 
+// Work items that are initialized long before they are pushed (timers of
+// dispatch_after(), group notifications) are stamped again when they are
+// actually enqueued, or their latency would include the delay or the wait
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_continuation_latency_restamp(dispatch_continuation_t dc)
+{
+#if DISPATCH_USE_QUEUE_LATENCY_TRACKING
+	if (unlikely(dc->dc_flags & DC_FLAG_LATENCY_STAMP)) {
+		dc->dc_other = (void *)(uintptr_t)_dispatch_uptime();
+	}
+#else
+	(void)dc;
+#endif
+}
+
 DISPATCH_ALWAYS_INLINE
 static inline dispatch_qos_t
 _dispatch_continuation_init(dispatch_continuation_t dc,
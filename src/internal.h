@@ -173,6 +173,8 @@ typedef union {
 	struct dispatch_semaphore_s *_dsema;
 	struct dispatch_data_s *_ddata;
 	struct dispatch_io_s *_dchannel;
+	struct dispatch_channel_s *_dch;
+	struct dispatch_strand_s *_dstr;
 
 	struct dispatch_continuation_s *_dc;
 	struct dispatch_sync_context_s *_dsc;
@@ -278,6 +280,7 @@ upcast(dispatch_object_t dou)
 #endif /* __ANDROID__ */
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <sys/mman.h>
 #include <netinet/in.h>
 #endif
@@ -350,6 +353,16 @@ DISPATCH_EXPORT DISPATCH_NOTHROW void dispatch_atfork_child(void);
 #define DISPATCH_USE_DTRACE_INTROSPECTION 1
 #endif
 
+// USDT probes emitted through <sys/sdt.h> are cheap enough to be compiled in
+// every variant of the library, see provider_sdt.h
+#ifndef DISPATCH_USE_SDT
+#if defined(__linux__) && HAVE_SYS_SDT_H && !DISPATCH_USE_DTRACE
+#define DISPATCH_USE_SDT 1
+#else
+#define DISPATCH_USE_SDT 0
+#endif
+#endif // !defined(DISPATCH_USE_SDT)
+
 #ifndef DISPATCH_DEBUG_QOS
 #define DISPATCH_DEBUG_QOS DISPATCH_DEBUG
 #endif
@@ -679,11 +692,51 @@ _dispatch_fork_becomes_unsafe(void)
 #ifndef DISPATCH_USE_WORKQUEUE_NARROWING
 #if HAVE_PTHREAD_WORKQUEUES && DISPATCH_MIN_REQUIRED_OSX_AT_LEAST(109900)
 #define DISPATCH_USE_WORKQUEUE_NARROWING 1
+#elif DISPATCH_USE_INTERNAL_WORKQUEUE && HAVE_DISPATCH_WORKQ_MONITORING
+#define DISPATCH_USE_WORKQUEUE_NARROWING 1
 #else
 #define DISPATCH_USE_WORKQUEUE_NARROWING 0
 #endif
 #endif // !defined(DISPATCH_USE_WORKQUEUE_NARROWING)
 
+#ifndef DISPATCH_USE_QUEUE_LATENCY_TRACKING
+#if __LP64__ // the enqueue time is stashed in a pointer-sized field
+#define DISPATCH_USE_QUEUE_LATENCY_TRACKING 1
+#else
+#define DISPATCH_USE_QUEUE_LATENCY_TRACKING 0
+#endif
+#endif // !defined(DISPATCH_USE_QUEUE_LATENCY_TRACKING)
+
+#ifndef DISPATCH_USE_CONTINUATION_DEADLINES
+#if __LP64__ // the deadline is stashed in a pointer-sized field
+#define DISPATCH_USE_CONTINUATION_DEADLINES 1
+#else
+#define DISPATCH_USE_CONTINUATION_DEADLINES 0
+#endif
+#endif // !defined(DISPATCH_USE_CONTINUATION_DEADLINES)
+
+// Co-allocate the source refs (and their unote linkage) at the tail of the
+// dispatch_source_s rather than in a separate malloc block. On Darwin they
+// stay separate so that 'leaks' can see sources <rdar://problem/9050566>.
+#ifndef DISPATCH_USE_INLINE_SOURCE_REFS
+#if defined(__APPLE__)
+#define DISPATCH_USE_INLINE_SOURCE_REFS 0
+#else
+#define DISPATCH_USE_INLINE_SOURCE_REFS 1
+#endif
+#endif // !defined(DISPATCH_USE_INLINE_SOURCE_REFS)
+
+// Allocate small dispatch objects from per size-class slabs, fronted by
+// per-thread caches, see _dispatch_object_alloc()
+#ifndef DISPATCH_USE_OBJECT_SLABS
+#if !USE_OBJC && DISPATCH_USE_THREAD_LOCAL_STORAGE && defined(__LP64__) && \
+		!defined(_WIN32)
+#define DISPATCH_USE_OBJECT_SLABS 1
+#else
+#define DISPATCH_USE_OBJECT_SLABS 0
+#endif
+#endif // !defined(DISPATCH_USE_OBJECT_SLABS)
+
 #ifndef DISPATCH_USE_PTHREAD_ROOT_QUEUES
 #if defined(__BLOCKS__) && defined(__APPLE__)
 #define DISPATCH_USE_PTHREAD_ROOT_QUEUES 1 // <rdar://problem/10719357>
@@ -785,11 +838,15 @@ extern bool _dispatch_memory_warn;
 #endif // HAVE_SYS_GUARDED_H
 
 
-#if DISPATCH_USE_DTRACE || DISPATCH_USE_DTRACE_INTROSPECTION
+#if DISPATCH_USE_DTRACE || DISPATCH_USE_DTRACE_INTROSPECTION || \
+		DISPATCH_USE_SDT
 typedef struct dispatch_trace_timer_params_s {
 	int64_t deadline, interval, leeway;
 } *dispatch_trace_timer_params_t;
 
+#if DISPATCH_USE_SDT
+#include "provider_sdt.h"
+#else
 #ifdef __cplusplus
 extern "C++" {
 #endif
@@ -797,7 +854,8 @@ extern "C++" {
 #ifdef __cplusplus
 }
 #endif
-#endif // DISPATCH_USE_DTRACE || DISPATCH_USE_DTRACE_INTROSPECTION
+#endif // DISPATCH_USE_SDT
+#endif // DISPATCH_USE_DTRACE || DISPATCH_USE_DTRACE_INTROSPECTION || ...
 
 #if __has_include(<sys/kdebug.h>)
 #include <sys/kdebug.h>
@@ -1049,6 +1107,7 @@ extern bool _dispatch_kevent_workqueue_enabled;
 #include "object_internal.h"
 #include "semaphore_internal.h"
 #include "introspection_internal.h"
+#include "trace_buffer_internal.h"
 #include "queue_internal.h"
 #include "source_internal.h"
 #include "mach_internal.h"
@@ -233,6 +233,10 @@ _dispatch_introspection_continuation_get_info(dispatch_queue_t dq,
 			break;
 		case DISPATCH_CONTINUATION_TYPE(MACH_SEND_BARRRIER_DRAIN):
 			break;
+#if DISPATCH_USE_CONTINUATION_DEADLINES
+		case DISPATCH_CONTINUATION_TYPE(DEADLINE):
+			break;
+#endif
 		case DISPATCH_CONTINUATION_TYPE(MACH_SEND_BARRIER):
 		case DISPATCH_CONTINUATION_TYPE(MACH_RECV_BARRIER):
 			flags = (uintptr_t)dc->dc_data;
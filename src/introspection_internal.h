@@ -38,6 +38,8 @@ enum dispatch_introspection_runtime_event {
 	dispatch_introspection_runtime_event_async_sync_handoff = 11,
 	dispatch_introspection_runtime_event_sync_sync_handoff = 12,
 	dispatch_introspection_runtime_event_sync_async_handoff = 13,
+
+	dispatch_introspection_runtime_event_deadline_expired = 20,
 };
 
 #if DISPATCH_INTROSPECTION
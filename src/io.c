@@ -28,6 +28,10 @@
 #define PAGE_SIZE ((size_t)getpagesize())
 #endif
 
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
 #if DISPATCH_DATA_IS_BRIDGED_TO_NSDATA
 #define _dispatch_io_data_retain(x) _dispatch_objc_retain(x)
 #define _dispatch_io_data_release(x) _dispatch_objc_release(x)
@@ -45,6 +49,8 @@ static dispatch_operation_t _dispatch_operation_create(
 		dispatch_op_direction_t direction, dispatch_io_t channel, off_t offset,
 		size_t length, dispatch_data_t data, dispatch_queue_t queue,
 		dispatch_io_handler_t handler);
+static void _dispatch_operation_set_destination(dispatch_operation_t op,
+		dispatch_data_t dst);
 static void _dispatch_operation_enqueue(dispatch_operation_t op,
 		dispatch_op_direction_t direction, dispatch_data_t data);
 static dispatch_source_t _dispatch_operation_timer(dispatch_queue_t tq,
@@ -626,6 +632,27 @@ dispatch_io_set_interval(dispatch_io_t channel, uint64_t interval,
 	});
 }
 
+void
+dispatch_io_set_datagram_batch(dispatch_io_t channel, size_t max_messages,
+		size_t max_size)
+{
+	_dispatch_retain(channel);
+	dispatch_async(channel->queue, ^{
+		_dispatch_channel_debug("set datagram batch: %zu x %zu", channel,
+				max_messages, max_size);
+		size_t count = max_size ? max_messages : 0;
+		if (channel->params.type != DISPATCH_IO_STREAM) {
+			count = 0;
+		}
+		channel->params.dgram_count = MIN(count, DIO_MAX_DATAGRAM_BATCH);
+		// bounds the size of the receive pool, see
+		// _dispatch_operation_recv_datagrams()
+		channel->params.dgram_size = count ?
+				MIN(max_size, DIO_MAX_DATAGRAM_SIZE) : 0;
+		_dispatch_release(channel);
+	});
+}
+
 void
 _dispatch_io_set_target_queue(dispatch_io_t channel, dispatch_queue_t dq)
 {
@@ -806,6 +833,58 @@ dispatch_io_read_f(dispatch_io_t channel, off_t offset, size_t length,
 	});
 }
 
+void
+dispatch_io_read_into(dispatch_io_t channel, off_t offset,
+		dispatch_data_t destination, dispatch_queue_t queue,
+		dispatch_io_handler_t handler)
+{
+	_dispatch_io_data_retain(destination);
+	_dispatch_retain(channel);
+	_dispatch_retain(queue);
+	dispatch_async(channel->queue, ^{
+		dispatch_operation_t op;
+		if (unlikely(channel->params.dgram_count)) {
+			// datagrams are received into a pool buffer shared by several
+			// batches, they can't be read in place
+			_dispatch_channel_debug("read into: datagram mode", channel);
+			_dispatch_retain(queue);
+			dispatch_async(channel->barrier_queue, ^{
+				dispatch_async(queue, ^{
+					handler(true, NULL, EINVAL);
+				});
+				_dispatch_release(queue);
+			});
+			op = NULL;
+		} else {
+			op = _dispatch_operation_create(DOP_DIR_READ, channel, offset,
+					dispatch_data_get_size(destination), dispatch_data_empty,
+					queue, handler);
+		}
+		if (op) {
+			_dispatch_operation_set_destination(op, destination);
+			dispatch_queue_t barrier_q = channel->barrier_queue;
+			dispatch_async(barrier_q, ^{
+				_dispatch_operation_enqueue(op, DOP_DIR_READ,
+						dispatch_data_empty);
+			});
+		}
+		_dispatch_io_data_release(destination);
+		_dispatch_release(channel);
+		_dispatch_release(queue);
+	});
+}
+
+void
+dispatch_io_read_into_f(dispatch_io_t channel, off_t offset,
+		dispatch_data_t destination, dispatch_queue_t queue, void *context,
+		dispatch_io_handler_function_t handler)
+{
+	return dispatch_io_read_into(channel, offset, destination, queue,
+			^(bool done, dispatch_data_t d, int error){
+		handler(context, done, d, error);
+	});
+}
+
 void
 dispatch_io_write(dispatch_io_t channel, off_t offset, dispatch_data_t data,
 		dispatch_queue_t queue, dispatch_io_handler_t handler)
@@ -1043,6 +1122,37 @@ _dispatch_operation_create(dispatch_op_direction_t direction,
 	return op;
 }
 
+static void
+_dispatch_operation_set_destination(dispatch_operation_t op,
+		dispatch_data_t dst)
+{
+	// On channel queue
+	// The regions of the destination are read into in place, describe them
+	// once as an iovec list that readv/preadv consume as the operation
+	// progresses
+	__block size_t iovcnt = 0;
+	dispatch_data_apply(dst, ^(dispatch_data_t region DISPATCH_UNUSED,
+			size_t offset DISPATCH_UNUSED, const void *buf DISPATCH_UNUSED,
+			size_t len DISPATCH_UNUSED) {
+		iovcnt++;
+		return (bool)true;
+	});
+	struct iovec *iov = _dispatch_calloc(iovcnt, sizeof(struct iovec));
+	__block size_t i = 0;
+	dispatch_data_apply(dst, ^(dispatch_data_t region DISPATCH_UNUSED,
+			size_t offset DISPATCH_UNUSED, const void *buf, size_t len) {
+		iov[i].iov_base = (void *)buf;
+		iov[i].iov_len = len;
+		i++;
+		return (bool)true;
+	});
+	_dispatch_io_data_retain(dst);
+	op->dst = dst;
+	op->dst_iov = iov;
+	op->dst_iovcnt = iovcnt;
+	_dispatch_op_debug("destination set: %zu regions", op, iovcnt);
+}
+
 void
 _dispatch_operation_dispose(dispatch_operation_t op,
 		DISPATCH_UNUSED bool *allow_free)
@@ -1071,6 +1181,10 @@ _dispatch_operation_dispose(dispatch_operation_t op,
 	if (op->data) {
 		_dispatch_io_data_release(op->data);
 	}
+	if (op->dst) {
+		_dispatch_io_data_release(op->dst);
+		free(op->dst_iov);
+	}
 	if (op->op_q) {
 		dispatch_release(op->op_q);
 	}
@@ -2174,6 +2288,188 @@ _dispatch_operation_advise(dispatch_operation_t op, size_t chunk_size)
 #endif
 }
 
+static ssize_t
+_dispatch_operation_readv(dispatch_operation_t op, size_t len, off_t off)
+{
+	// Scatter into the destination regions that follow the data read so far,
+	// with the last region truncated to the remaining length of the window
+	struct iovec *iov = &op->dst_iov[op->dst_iov_idx];
+	size_t i = 0, n = op->dst_iovcnt - op->dst_iov_idx;
+	if (n > (size_t)IOV_MAX) {
+		n = (size_t)IOV_MAX;
+	}
+	while (i + 1 < n && iov[i].iov_len < len) {
+		len -= iov[i].iov_len;
+		i++;
+	}
+	size_t tail_len = iov[i].iov_len;
+	if (len < tail_len) {
+		iov[i].iov_len = len;
+	}
+	ssize_t processed = -1;
+	if (op->params.type == DISPATCH_IO_STREAM) {
+		processed = readv(op->fd_entry->fd, iov, (int)i + 1);
+	} else if (op->params.type == DISPATCH_IO_RANDOM) {
+#if HAVE_PREADV
+		processed = preadv(op->fd_entry->fd, iov, (int)i + 1, off);
+#else
+		// Short reads are always permitted, fill one region at a time
+		processed = pread(op->fd_entry->fd, iov[0].iov_base, iov[0].iov_len,
+				off);
+#endif
+	}
+	iov[i].iov_len = tail_len;
+	return processed;
+}
+
+static void
+_dispatch_operation_dst_advance(dispatch_operation_t op, size_t processed)
+{
+	while (processed) {
+		struct iovec *iov = &op->dst_iov[op->dst_iov_idx];
+		if (processed < iov->iov_len) {
+			iov->iov_base = (char *)iov->iov_base + processed;
+			iov->iov_len -= processed;
+			break;
+		}
+		processed -= iov->iov_len;
+		iov->iov_len = 0;
+		op->dst_iov_idx++;
+	}
+}
+
+static ssize_t
+_dispatch_operation_recv_datagrams(dispatch_operation_t op)
+{
+	size_t size = op->params.dgram_size, total, i, n;
+	struct iovec iov[DIO_MAX_DATAGRAM_BATCH];
+	range_record records[DIO_MAX_DATAGRAM_BATCH];
+	ssize_t len;
+
+	// Datagrams are received into the free slots of a pool buffer that is
+	// shared by all of them, and delivered as the records of a composite
+	// data object referencing that buffer, one record per datagram
+refill:
+	if (!op->buf_data || op->dgram_slot == op->params.dgram_count) {
+		if (op->buf_data) {
+			_dispatch_io_data_release(op->buf_data);
+		}
+		op->buf_data = dispatch_data_create_alloc(
+				op->params.dgram_count * size, &op->dgram_buf);
+		op->dgram_slot = 0;
+		_dispatch_op_debug("datagram pool allocated", op);
+	}
+	size_t count = op->params.dgram_count - op->dgram_slot;
+	for (i = 0; i < count; i++) {
+		iov[i].iov_base = (char *)op->dgram_buf + (op->dgram_slot + i) * size;
+		iov[i].iov_len = size;
+	}
+again:
+	total = n = 0;
+#if HAVE_RECVMMSG
+	struct mmsghdr msgs[DIO_MAX_DATAGRAM_BATCH] = { };
+	for (i = 0; i < count; i++) {
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	int r = recvmmsg(op->fd_entry->fd, msgs, (unsigned int)count, MSG_DONTWAIT,
+			NULL);
+	if (r == -1) {
+		return -1;
+	}
+	for (i = 0; i < (size_t)r; i++) {
+		len = (ssize_t)msgs[i].msg_len;
+#else
+	for (i = 0; i < count; i++) {
+		len = recv(op->fd_entry->fd, iov[i].iov_base, size, MSG_DONTWAIT);
+		if (len == -1) {
+			if (i) break;
+			return -1;
+		}
+#endif
+		if (!len) {
+			continue;
+		}
+		records[n++] = (range_record){
+			.data_object = op->buf_data,
+			.from = (op->dgram_slot + i) * size,
+			.length = (size_t)len,
+		};
+		total += (size_t)len;
+	}
+	op->dgram_slot += i;
+	if (!n) {
+		if (i) {
+			// Only empty datagrams, which are not delivered, keep going
+			if (op->dgram_slot == op->params.dgram_count) {
+				goto refill;
+			}
+			count -= i;
+			memmove(iov, &iov[i], count * sizeof(struct iovec));
+			goto again;
+		}
+		// Nothing was received, a return of 0 would be taken for EOF, wait
+		// for the next event instead
+		errno = EAGAIN;
+		return -1;
+	}
+	dispatch_data_t batch = _dispatch_data_create_with_records(records, n);
+	dispatch_data_t d = dispatch_data_create_concat(op->data, batch);
+	_dispatch_io_data_release(batch);
+	_dispatch_io_data_release(op->data);
+	op->data = d;
+	_dispatch_op_debug("received %zu datagrams", op, n);
+	return (ssize_t)total;
+}
+
+static ssize_t
+_dispatch_operation_send_datagrams(dispatch_operation_t op)
+{
+	struct iovec iov[DIO_MAX_DATAGRAM_BATCH];
+	__block size_t count = 0;
+	size_t total = 0, i;
+
+	// Each region of the data being written is sent as one datagram
+	dispatch_data_apply(op->data, ^(dispatch_data_t region DISPATCH_UNUSED,
+			size_t offset DISPATCH_UNUSED, const void *buf, size_t len) {
+		iov[count].iov_base = (void *)buf;
+		iov[count].iov_len = len;
+		return (bool)(++count < op->params.dgram_count);
+	});
+#if HAVE_SENDMMSG
+	struct mmsghdr msgs[DIO_MAX_DATAGRAM_BATCH] = { };
+	for (i = 0; i < count; i++) {
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	int r = sendmmsg(op->fd_entry->fd, msgs, (unsigned int)count,
+			MSG_DONTWAIT);
+	if (r == -1) {
+		return -1;
+	}
+	for (i = 0; i < (size_t)r; i++) {
+		total += msgs[i].msg_len;
+	}
+#else
+	for (i = 0; i < count; i++) {
+		ssize_t len = send(op->fd_entry->fd, iov[i].iov_base, iov[i].iov_len,
+				MSG_DONTWAIT);
+		if (len == -1) {
+			if (i) break;
+			return -1;
+		}
+		total += (size_t)len;
+	}
+#endif
+	// Trim the datagrams that were sent from the head of the unwritten data
+	dispatch_data_t d = dispatch_data_create_subrange(op->data, total,
+			op->length);
+	_dispatch_io_data_release(op->data);
+	op->data = d;
+	_dispatch_op_debug("sent %zu datagrams", op, i);
+	return (ssize_t)total;
+}
+
 static int
 _dispatch_operation_perform(dispatch_operation_t op)
 {
@@ -2183,13 +2479,18 @@ _dispatch_operation_perform(dispatch_operation_t op)
 		goto error;
 	}
 	_dispatch_object_debug(op, "%s", __func__);
-	if (!op->buf) {
+	if (op->params.dgram_count) {
+		// Datagrams are exchanged directly with the regions of op->data
+	} else if (op->dst ? !op->buf_siz : !op->buf) {
 		size_t max_buf_siz = op->params.high;
 		size_t chunk_siz = dispatch_io_defaults.chunk_size;
 		if (op->direction == DOP_DIR_READ) {
 			// If necessary, create a buffer for the ongoing operation, large
-			// enough to fit chunk_size but at most high-water
-			size_t data_siz = dispatch_data_get_size(op->data);
+			// enough to fit chunk_size but at most high-water. Reads into a
+			// caller-supplied destination use the same bounds for the window
+			// of the destination filled before the next delivery check
+			size_t data_siz = op->dst ? op->total - op->dst_off :
+					dispatch_data_get_size(op->data);
 			if (data_siz) {
 				dispatch_assert(data_siz < max_buf_siz);
 				max_buf_siz -= data_siz;
@@ -2205,8 +2506,10 @@ _dispatch_operation_perform(dispatch_operation_t op)
 			} else {
 				op->buf_siz = max_buf_siz;
 			}
-			op->buf = valloc(op->buf_siz);
-			_dispatch_op_debug("buffer allocated", op);
+			if (!op->dst) {
+				op->buf = valloc(op->buf_siz);
+				_dispatch_op_debug("buffer allocated", op);
+			}
 		} else if (op->direction == DOP_DIR_WRITE) {
 			// Always write the first data piece, if that is smaller than a
 			// chunk, accumulate further data pieces until chunk size is reached
@@ -2246,8 +2549,16 @@ _dispatch_operation_perform(dispatch_operation_t op)
 	off_t off = (off_t)((size_t)op->offset + op->total);
 	ssize_t processed = -1;
 syscall:
-	if (op->direction == DOP_DIR_READ) {
-		if (op->params.type == DISPATCH_IO_STREAM) {
+	if (op->params.dgram_count) {
+		if (op->direction == DOP_DIR_READ) {
+			processed = _dispatch_operation_recv_datagrams(op);
+		} else if (op->direction == DOP_DIR_WRITE) {
+			processed = _dispatch_operation_send_datagrams(op);
+		}
+	} else if (op->direction == DOP_DIR_READ) {
+		if (op->dst) {
+			processed = _dispatch_operation_readv(op, len, off);
+		} else if (op->params.type == DISPATCH_IO_STREAM) {
 			processed = read(op->fd_entry->fd, buf, len);
 		} else if (op->params.type == DISPATCH_IO_RANDOM) {
 			processed = pread(op->fd_entry->fd, buf, len, off);
@@ -2272,9 +2583,17 @@ syscall:
 		_dispatch_op_debug("performed: EOF", op);
 		return DISPATCH_OP_DELIVER_AND_COMPLETE;
 	}
-	op->buf_len += (size_t)processed;
+	if (op->dst) {
+		_dispatch_operation_dst_advance(op, (size_t)processed);
+	}
+	if (op->params.dgram_count) {
+		// Datagrams are accounted for in op->data rather than in a buffer
+		op->undelivered += (size_t)processed;
+	} else {
+		op->buf_len += (size_t)processed;
+	}
 	op->total += (size_t)processed;
-	if (op->total == op->length) {
+	if (op->total >= op->length) {
 		// Finished processing all the bytes requested by the operation
 		return DISPATCH_OP_COMPLETE;
 	} else {
@@ -2334,7 +2653,19 @@ _dispatch_operation_deliver_data(dispatch_operation_t op,
 		}
 	}
 	// Deliver data or buffer used up
-	if (op->direction == DOP_DIR_READ) {
+	if (op->direction == DOP_DIR_READ && op->dst) {
+		// Data read into the destination is delivered as subranges of it
+		if (deliver) {
+			size_t siz = op->total - op->dst_off;
+			data = siz ? dispatch_data_create_subrange(op->dst, op->dst_off,
+					siz) : dispatch_data_empty;
+			op->dst_off = op->total;
+		}
+		if (deliver || op->buf_len == op->buf_siz) {
+			op->buf_siz = 0;
+			op->buf_len = 0;
+		}
+	} else if (op->direction == DOP_DIR_READ) {
 		if (op->buf_len) {
 			void *buf = op->buf;
 			data = dispatch_data_create(buf, op->buf_len, NULL,
@@ -46,6 +46,8 @@
 
 #define DIO_DEFAULT_LOW_WATER_CHUNKS	  1u // default low-water mark
 #define DIO_MAX_PENDING_IO_REQS			  6u // Pending I/O read advises
+#define DIO_MAX_DATAGRAM_BATCH			 64u // datagrams per recv/sendmmsg
+#define DIO_MAX_DATAGRAM_SIZE		(64u * 1024) // bytes per received datagram
 
 typedef unsigned int dispatch_op_direction_t;
 enum {
@@ -138,6 +140,8 @@ typedef struct dispatch_io_param_s {
 	size_t high;
 	uint64_t interval;
 	unsigned long interval_flags;
+	size_t dgram_count; // datagram mode if non-zero
+	size_t dgram_size;
 } dispatch_io_param_s;
 
 struct dispatch_operation_s {
@@ -158,6 +162,13 @@ struct dispatch_operation_s {
 	dispatch_op_flags_t flags;
 	size_t buf_siz, buf_len, undelivered, total;
 	dispatch_data_t buf_data, data;
+	// caller-supplied read destination (dispatch_io_read_into)
+	dispatch_data_t dst;
+	struct iovec *dst_iov;
+	size_t dst_iovcnt, dst_iov_idx, dst_off;
+	// datagram mode receive pool, owned by buf_data
+	void *dgram_buf;
+	size_t dgram_slot;
 	TAILQ_ENTRY(dispatch_operation_s) operation_list;
 	// the request list in the fd_entry stream_ops
 	TAILQ_ENTRY(dispatch_operation_s) stream_list;
@@ -134,6 +134,305 @@ _os_object_allows_weak_reference(_os_object_t obj)
 	return true;
 }
 
+#pragma mark -
+#pragma mark dispatch_object_t slabs
+#if DISPATCH_USE_OBJECT_SLABS
+
+// Dispatch objects of at most DISPATCH_OBJECT_SLAB_MAX_SIZE bytes are carved
+// from slabs holding a single size class, inside a region of address space
+// reserved up front, so that _dispatch_object_dealloc() can tell them apart
+// from malloc()ed objects with a range check, and find their size class in
+// _dispatch_object_slab_classes.
+//
+// Freed objects go to a per-thread cache for their size class. Once it holds
+// two magazines worth of objects, one magazine (a chain of free objects) is
+// handed to the depot of the class, a lock-free stack whose head packs
+// a generation count with the index of the top chain within the region.
+// A thread with an empty cache takes a magazine from the depot, or carves
+// a new one from a slab.
+#define DISPATCH_OBJECT_SLAB_QUANTUM      16u
+#define DISPATCH_OBJECT_SLAB_MIN_SIZE     64u
+#define DISPATCH_OBJECT_SLAB_MAX_SIZE     512u
+#define DISPATCH_OBJECT_SLAB_CLASS_COUNT \
+		((DISPATCH_OBJECT_SLAB_MAX_SIZE - DISPATCH_OBJECT_SLAB_MIN_SIZE) / \
+		DISPATCH_OBJECT_SLAB_QUANTUM + 1)
+#define DISPATCH_OBJECT_SLAB_SIZE         (64ul << 10)
+#define DISPATCH_OBJECT_SLAB_REGION_SIZE  (4ul << 30)
+#define DISPATCH_OBJECT_SLAB_COUNT \
+		(DISPATCH_OBJECT_SLAB_REGION_SIZE / DISPATCH_OBJECT_SLAB_SIZE)
+#define DISPATCH_OBJECT_MAGAZINE_SIZE     32u
+
+// chain indices are in quantums, and have to fit in the low half of dod_head
+dispatch_static_assert(DISPATCH_OBJECT_SLAB_REGION_SIZE /
+		DISPATCH_OBJECT_SLAB_QUANTUM < UINT32_MAX);
+dispatch_static_assert(DISPATCH_OBJECT_SLAB_CLASS_COUNT <= UINT8_MAX);
+
+typedef struct dispatch_object_free_s {
+	struct dispatch_object_free_s *dof_next;
+	// only valid on the first object of a chain pushed to a depot
+	os_atomic(uint32_t) dof_chain_next;
+	uint32_t dof_chain_count;
+} *dispatch_object_free_t;
+
+typedef struct dispatch_object_depot_s {
+	os_atomic(uint64_t) dod_head;
+	dispatch_unfair_lock_s dod_carve_lock;
+	size_t dod_carve_offset;
+	char *dod_carve_slab;
+} DISPATCH_CACHELINE_ALIGN *dispatch_object_depot_t;
+
+typedef struct dispatch_object_cache_s {
+	dispatch_object_free_t doc_head;
+	uint32_t doc_count;
+} *dispatch_object_cache_t;
+
+static dispatch_once_t _dispatch_object_slab_pred;
+static uintptr_t _dispatch_object_slab_base;
+static os_atomic(uint32_t) _dispatch_object_slab_count;
+static uint8_t _dispatch_object_slab_classes[DISPATCH_OBJECT_SLAB_COUNT];
+static struct dispatch_object_depot_s
+		_dispatch_object_depots[DISPATCH_OBJECT_SLAB_CLASS_COUNT];
+static __thread struct dispatch_object_cache_s
+		__dispatch_object_caches[DISPATCH_OBJECT_SLAB_CLASS_COUNT];
+
+DISPATCH_ALWAYS_INLINE
+static inline size_t
+_dispatch_object_slab_class(size_t size)
+{
+	if (size <= DISPATCH_OBJECT_SLAB_MIN_SIZE) return 0;
+	return (size - DISPATCH_OBJECT_SLAB_MIN_SIZE +
+			DISPATCH_OBJECT_SLAB_QUANTUM - 1) / DISPATCH_OBJECT_SLAB_QUANTUM;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline size_t
+_dispatch_object_slab_class_size(size_t cls)
+{
+	return DISPATCH_OBJECT_SLAB_MIN_SIZE + cls * DISPATCH_OBJECT_SLAB_QUANTUM;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline uint32_t
+_dispatch_object_slab_index(dispatch_object_free_t dof)
+{
+	// 0 is the empty depot
+	return (uint32_t)(((uintptr_t)dof - _dispatch_object_slab_base) /
+			DISPATCH_OBJECT_SLAB_QUANTUM) + 1;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_object_free_t
+_dispatch_object_slab_from_index(uint32_t idx)
+{
+	return (dispatch_object_free_t)(_dispatch_object_slab_base +
+			(uintptr_t)(idx - 1) * DISPATCH_OBJECT_SLAB_QUANTUM);
+}
+
+static void
+_dispatch_object_slab_region_init(void *ctxt DISPATCH_UNUSED)
+{
+	void *base;
+
+	if (!_dispatch_getenv_bool("LIBDISPATCH_OBJECT_SLABS", true)) {
+		return;
+	}
+	// slabs are only made accessible (and accounted for) once carved
+	base = mmap(NULL, DISPATCH_OBJECT_SLAB_REGION_SIZE, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		return;
+	}
+	_dispatch_object_slab_base = (uintptr_t)base;
+}
+
+static char *
+_dispatch_object_slab_map(size_t cls)
+{
+	uint32_t idx = os_atomic_load(&_dispatch_object_slab_count, relaxed);
+	char *slab;
+
+	do {
+		if (unlikely(idx >= DISPATCH_OBJECT_SLAB_COUNT)) {
+			return NULL;
+		}
+	} while (!os_atomic_cmpxchgv(&_dispatch_object_slab_count,
+			idx, idx + 1, &idx, relaxed));
+
+	slab = (char *)_dispatch_object_slab_base + idx * DISPATCH_OBJECT_SLAB_SIZE;
+	if (mprotect(slab, DISPATCH_OBJECT_SLAB_SIZE, PROT_READ | PROT_WRITE)) {
+		(void)dispatch_assume_zero(errno);
+		return NULL;
+	}
+	_dispatch_object_slab_classes[idx] = (uint8_t)cls;
+	return slab;
+}
+
+static dispatch_object_free_t
+_dispatch_object_slab_carve(dispatch_object_depot_t dod, size_t cls,
+		uint32_t *count)
+{
+	size_t size = _dispatch_object_slab_class_size(cls);
+	dispatch_object_free_t head = NULL, *tail = &head, dof;
+	uint32_t n;
+
+	_dispatch_unfair_lock_lock(&dod->dod_carve_lock);
+	for (n = 0; n < DISPATCH_OBJECT_MAGAZINE_SIZE; n++) {
+		if (!dod->dod_carve_slab ||
+				dod->dod_carve_offset + size > DISPATCH_OBJECT_SLAB_SIZE) {
+			char *slab = _dispatch_object_slab_map(cls);
+			if (unlikely(!slab)) break;
+			dod->dod_carve_slab = slab;
+			dod->dod_carve_offset = 0;
+		}
+		dof = (dispatch_object_free_t)(dod->dod_carve_slab +
+				dod->dod_carve_offset);
+		dod->dod_carve_offset += size;
+		*tail = dof;
+		tail = &dof->dof_next;
+	}
+	_dispatch_unfair_lock_unlock(&dod->dod_carve_lock);
+	*tail = NULL;
+	*count = n;
+	return head;
+}
+
+static void
+_dispatch_object_depot_push(dispatch_object_depot_t dod,
+		dispatch_object_free_t dof, uint32_t count)
+{
+	uint32_t idx = _dispatch_object_slab_index(dof);
+	uint64_t old_head, new_head;
+
+	dof->dof_chain_count = count;
+	os_atomic_rmw_loop(&dod->dod_head, old_head, new_head, release, {
+		os_atomic_store(&dof->dof_chain_next, (uint32_t)old_head, relaxed);
+		new_head = (((old_head >> 32) + 1) << 32) | idx;
+	});
+}
+
+static dispatch_object_free_t
+_dispatch_object_depot_pop(dispatch_object_depot_t dod, uint32_t *count)
+{
+	dispatch_object_free_t dof;
+	uint64_t old_head, new_head;
+
+	os_atomic_rmw_loop(&dod->dod_head, old_head, new_head, acquire, {
+		if (!(uint32_t)old_head) {
+			os_atomic_rmw_loop_give_up(return NULL);
+		}
+		// slabs are never unmapped, so this is safe to read even if another
+		// thread popped this chain already, the generation makes the cmpxchg
+		// fail in that case
+		dof = _dispatch_object_slab_from_index((uint32_t)old_head);
+		new_head = (((old_head >> 32) + 1) << 32) |
+				os_atomic_load(&dof->dof_chain_next, relaxed);
+	});
+	*count = dof->dof_chain_count;
+	return dof;
+}
+
+DISPATCH_NOINLINE
+static dispatch_object_free_t
+_dispatch_object_slab_refill(dispatch_object_cache_t doc, size_t cls)
+{
+	dispatch_object_depot_t dod = &_dispatch_object_depots[cls];
+	dispatch_object_free_t dof;
+	uint32_t count;
+
+	dispatch_once_f(&_dispatch_object_slab_pred, NULL,
+			_dispatch_object_slab_region_init);
+	if (unlikely(!_dispatch_object_slab_base)) {
+		return NULL;
+	}
+	dof = _dispatch_object_depot_pop(dod, &count);
+	if (!dof) {
+		dof = _dispatch_object_slab_carve(dod, cls, &count);
+		if (unlikely(!dof)) return NULL;
+	}
+	_dispatch_stats_inc(dispatch_stat_object_slab_miss);
+	// the rest of the magazine now lives in this thread's cache, make sure
+	// _dispatch_object_slab_thread_cleanup() returns it when the thread exits
+	(void)_dispatch_get_tsd_base();
+	doc->doc_head = dof->dof_next;
+	doc->doc_count = count - 1;
+	return dof;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void *
+_dispatch_object_slab_alloc(size_t size)
+{
+	size_t cls = _dispatch_object_slab_class(size);
+	dispatch_object_cache_t doc = &__dispatch_object_caches[cls];
+	dispatch_object_free_t dof = doc->doc_head;
+
+	if (likely(dof)) {
+		doc->doc_head = dof->dof_next;
+		doc->doc_count--;
+		_dispatch_stats_inc(dispatch_stat_object_slab_hit);
+	} else {
+		dof = _dispatch_object_slab_refill(doc, cls);
+		if (unlikely(!dof)) return NULL;
+	}
+	_dispatch_stats_add(dispatch_stat_object_slab_bytes_alloc,
+			_dispatch_object_slab_class_size(cls));
+	return memset(dof, 0, size);
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_object_slab_free(void *ptr, size_t offset)
+{
+	size_t cls = _dispatch_object_slab_classes[offset /
+			DISPATCH_OBJECT_SLAB_SIZE];
+	dispatch_object_cache_t doc = &__dispatch_object_caches[cls];
+	dispatch_object_free_t dof = ptr, last;
+
+	// so that _dispatch_object_slab_thread_cleanup() runs for this thread
+	(void)_dispatch_get_tsd_base();
+	dof->dof_next = doc->doc_head;
+	doc->doc_head = dof;
+	if (unlikely(++doc->doc_count >= 2 * DISPATCH_OBJECT_MAGAZINE_SIZE)) {
+		// keep the most recently freed magazine, hand the other to the depot
+		last = dof;
+		for (uint32_t i = 1; i < DISPATCH_OBJECT_MAGAZINE_SIZE; i++) {
+			last = last->dof_next;
+		}
+		dof = last->dof_next;
+		last->dof_next = NULL;
+		_dispatch_object_depot_push(&_dispatch_object_depots[cls], dof,
+				doc->doc_count - DISPATCH_OBJECT_MAGAZINE_SIZE);
+		doc->doc_count = DISPATCH_OBJECT_MAGAZINE_SIZE;
+	}
+	_dispatch_stats_add(dispatch_stat_object_slab_bytes_free,
+			_dispatch_object_slab_class_size(cls));
+}
+
+void
+_dispatch_object_slab_thread_cleanup(void)
+{
+	dispatch_object_cache_t doc;
+
+	for (size_t cls = 0; cls < DISPATCH_OBJECT_SLAB_CLASS_COUNT; cls++) {
+		doc = &__dispatch_object_caches[cls];
+		if (doc->doc_head) {
+			_dispatch_object_depot_push(&_dispatch_object_depots[cls],
+					doc->doc_head, doc->doc_count);
+			doc->doc_head = NULL;
+			doc->doc_count = 0;
+		}
+	}
+}
+
+uint64_t
+_dispatch_object_slab_bytes_reserved(void)
+{
+	uint32_t count = os_atomic_load(&_dispatch_object_slab_count, relaxed);
+	return (uint64_t)count * DISPATCH_OBJECT_SLAB_SIZE;
+}
+
+#endif // DISPATCH_USE_OBJECT_SLABS
+
 #pragma mark -
 #pragma mark dispatch_object_t
 
@@ -147,6 +446,15 @@ _dispatch_object_alloc(const void *vtable, size_t size)
 	dou._do->do_vtable = vtable;
 	return dou._do;
 #else
+#if DISPATCH_USE_OBJECT_SLABS
+	if (likely(size <= DISPATCH_OBJECT_SLAB_MAX_SIZE)) {
+		_os_object_t obj = _dispatch_object_slab_alloc(size);
+		if (likely(obj)) {
+			obj->os_obj_isa = vtable;
+			return obj;
+		}
+	}
+#endif
 	return _os_object_alloc_realized(vtable, size);
 #endif
 }
@@ -168,6 +476,13 @@ _dispatch_object_dealloc(dispatch_object_t dou)
 	dou._os_obj->os_obj_isa = NULL;
 #if OS_OBJECT_HAVE_OBJC1
 	dou._do->do_vtable = NULL;
+#endif
+#if DISPATCH_USE_OBJECT_SLABS
+	size_t offset = (uintptr_t)dou._os_obj - _dispatch_object_slab_base;
+	if (_dispatch_object_slab_base &&
+			offset < DISPATCH_OBJECT_SLAB_REGION_SIZE) {
+		return _dispatch_object_slab_free(dou._os_obj, offset);
+	}
 #endif
 	free(dou._os_obj);
 }
@@ -197,6 +512,9 @@ _dispatch_xref_dispose(dispatch_object_t dou)
 	case DISPATCH_SOURCE_KEVENT_TYPE:
 		_dispatch_source_xref_dispose(dou._ds);
 		break;
+	case DISPATCH_CHANNEL_TYPE:
+		_dispatch_channel_xref_dispose(dou._dch);
+		break;
 #if HAVE_MACH
 	case DISPATCH_MACH_CHANNEL_TYPE:
 		_dispatch_mach_xref_dispose(dou._dm);
@@ -286,6 +604,9 @@ dispatch_set_target_queue(dispatch_object_t dou, dispatch_queue_t tq)
 		// <rdar://problem/34417216> FIXME: dispatch IO should be a "source"
 		return _dispatch_io_set_target_queue(dou._dchannel, tq);
 	}
+	if (unlikely(dx_type(dou._do) == DISPATCH_STRAND_TYPE)) {
+		DISPATCH_CLIENT_CRASH(0, "Cannot change the target queue of a strand");
+	}
 	if (tq == DISPATCH_TARGET_QUEUE_DEFAULT) {
 		tq = _dispatch_get_default_queue(false);
 	}
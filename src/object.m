@@ -345,6 +345,23 @@ DISPATCH_UNAVAILABLE_INIT()
 
 @end
 
+@implementation DISPATCH_CLASS(channel)
+DISPATCH_OBJC_LOAD()
+DISPATCH_UNAVAILABLE_INIT()
+
+- (void)_xref_dispose {
+	_dispatch_channel_xref_dispose((struct dispatch_channel_s *)self);
+	[super _xref_dispose];
+}
+
+@end
+
+@implementation DISPATCH_CLASS(strand)
+DISPATCH_OBJC_LOAD()
+DISPATCH_UNAVAILABLE_INIT()
+
+@end
+
 @implementation DISPATCH_CLASS(mach)
 DISPATCH_OBJC_LOAD()
 DISPATCH_UNAVAILABLE_INIT()
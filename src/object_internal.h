@@ -267,6 +267,9 @@ DISPATCH_ENUM(dispatch_wakeup_flags, uint32_t,
 typedef struct dispatch_invoke_context_s {
 #if DISPATCH_USE_WORKQUEUE_NARROWING
 	uint64_t dic_next_narrow_check;
+#if DISPATCH_USE_INTERNAL_WORKQUEUE
+	dispatch_priority_t dic_narrow_priority;
+#endif
 #endif
 	struct dispatch_object_s *dic_barrier_waiter;
 	dispatch_qos_t dic_barrier_waiter_bucket;
@@ -372,6 +375,8 @@ enum {
 	_DISPATCH_IO_TYPE				= 0x00000003, // meta-type for io channels
 	_DISPATCH_OPERATION_TYPE		= 0x00000004, // meta-type for io operations
 	_DISPATCH_DISK_TYPE				= 0x00000005, // meta-type for io disks
+	_DISPATCH_CHANNEL_TYPE			= 0x00000006, // meta-type for channels
+	_DISPATCH_STRAND_TYPE			= 0x00000007, // meta-type for strands
 
 	_DISPATCH_QUEUE_CLUSTER         = 0x00000010, // dispatch queue cluster
 	_DISPATCH_LANE_TYPE				= 0x00000011, // meta-type for lanes
@@ -400,6 +405,9 @@ enum {
 	DISPATCH_OPERATION_TYPE				= DISPATCH_OBJECT_SUBTYPE(0, OPERATION),
 	DISPATCH_DISK_TYPE					= DISPATCH_OBJECT_SUBTYPE(0, DISK),
 
+	DISPATCH_CHANNEL_TYPE				= DISPATCH_OBJECT_SUBTYPE(0, CHANNEL),
+	DISPATCH_STRAND_TYPE				= DISPATCH_OBJECT_SUBTYPE(0, STRAND),
+
 	DISPATCH_QUEUE_SERIAL_TYPE			= DISPATCH_OBJECT_SUBTYPE(1, LANE),
 	DISPATCH_QUEUE_CONCURRENT_TYPE		= DISPATCH_OBJECT_SUBTYPE(2, LANE),
 	DISPATCH_QUEUE_GLOBAL_ROOT_TYPE		= DISPATCH_OBJECT_SUBTYPE(3, LANE) |
@@ -479,6 +487,10 @@ size_t _dispatch_object_debug_attr(dispatch_object_t dou, char* buf,
 void *_dispatch_object_alloc(const void *vtable, size_t size);
 void _dispatch_object_finalize(dispatch_object_t dou);
 void _dispatch_object_dealloc(dispatch_object_t dou);
+#if DISPATCH_USE_OBJECT_SLABS
+void _dispatch_object_slab_thread_cleanup(void);
+uint64_t _dispatch_object_slab_bytes_reserved(void);
+#endif
 #if !USE_OBJC
 void _dispatch_xref_dispose(dispatch_object_t dou);
 #endif
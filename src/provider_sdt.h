@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2019 Apple Inc. All rights reserved.
+ *
+ * @APPLE_APACHE_LICENSE_HEADER_START@
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @APPLE_APACHE_LICENSE_HEADER_END@
+ */
+
+/*
+ * IMPORTANT: This header file describes INTERNAL interfaces to libdispatch
+ * which are subject to change in future releases of Mac OS X. Any applications
+ * relying on these interfaces WILL break.
+ */
+
+/*
+ * USDT probes for the dispatch provider described in provider.d, emitted
+ * through <sys/sdt.h> instead of a header generated by the dtrace tool.
+ *
+ * Every probe has a semaphore that tools such as bpftrace or perf increment
+ * when they attach to it, so that the arguments of a probe are only computed
+ * while something listens. When nothing is attached, a probe costs a load and
+ * a not-taken branch, plus a nop at the probe site itself.
+ */
+
+#ifndef __DISPATCH_PROVIDER_SDT__
+#define __DISPATCH_PROVIDER_SDT__
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define DISPATCH_SDT_SEMAPHORE(name) dispatch_##name##_semaphore
+#define DISPATCH_SDT_ENABLED(name) \
+		__builtin_expect(DISPATCH_SDT_SEMAPHORE(name) != 0, 0)
+
+// the semaphores are defined in init.c
+#define DISPATCH_SDT_SEMAPHORE_DECL(name) \
+		extern volatile unsigned short DISPATCH_SDT_SEMAPHORE(name) \
+		__attribute__((__section__(".probes"), __visibility__("hidden")))
+
+DISPATCH_SDT_SEMAPHORE_DECL(queue__push);
+DISPATCH_SDT_SEMAPHORE_DECL(queue__pop);
+DISPATCH_SDT_SEMAPHORE_DECL(callout__entry);
+DISPATCH_SDT_SEMAPHORE_DECL(callout__return);
+DISPATCH_SDT_SEMAPHORE_DECL(timer__configure);
+DISPATCH_SDT_SEMAPHORE_DECL(timer__program);
+DISPATCH_SDT_SEMAPHORE_DECL(timer__wake);
+DISPATCH_SDT_SEMAPHORE_DECL(timer__fire);
+DISPATCH_SDT_SEMAPHORE_DECL(after__fire);
+DISPATCH_SDT_SEMAPHORE_DECL(runtime__event);
+
+#define DISPATCH_QUEUE_PUSH_ENABLED() DISPATCH_SDT_ENABLED(queue__push)
+#define DISPATCH_QUEUE_PUSH(queue, label, item, kind, function, context) \
+		STAP_PROBE6(dispatch, queue__push, queue, label, item, kind, \
+				function, context)
+
+#define DISPATCH_QUEUE_POP_ENABLED() DISPATCH_SDT_ENABLED(queue__pop)
+#define DISPATCH_QUEUE_POP(queue, label, item, kind, function, context) \
+		STAP_PROBE6(dispatch, queue__pop, queue, label, item, kind, \
+				function, context)
+
+#define DISPATCH_CALLOUT_ENTRY_ENABLED() DISPATCH_SDT_ENABLED(callout__entry)
+#define DISPATCH_CALLOUT_ENTRY(queue, label, function, context) \
+		STAP_PROBE4(dispatch, callout__entry, queue, label, function, context)
+
+#define DISPATCH_CALLOUT_RETURN_ENABLED() DISPATCH_SDT_ENABLED(callout__return)
+#define DISPATCH_CALLOUT_RETURN(queue, label, function, context) \
+		STAP_PROBE4(dispatch, callout__return, queue, label, function, context)
+
+#define DISPATCH_TIMER_CONFIGURE_ENABLED() \
+		DISPATCH_SDT_ENABLED(timer__configure)
+#define DISPATCH_TIMER_CONFIGURE(source, handler, params) \
+		STAP_PROBE3(dispatch, timer__configure, source, handler, params)
+
+#define DISPATCH_TIMER_PROGRAM_ENABLED() DISPATCH_SDT_ENABLED(timer__program)
+#define DISPATCH_TIMER_PROGRAM(source, handler, params) \
+		STAP_PROBE3(dispatch, timer__program, source, handler, params)
+
+#define DISPATCH_TIMER_WAKE_ENABLED() DISPATCH_SDT_ENABLED(timer__wake)
+#define DISPATCH_TIMER_WAKE(source, handler) \
+		STAP_PROBE2(dispatch, timer__wake, source, handler)
+
+#define DISPATCH_TIMER_FIRE_ENABLED() DISPATCH_SDT_ENABLED(timer__fire)
+#define DISPATCH_TIMER_FIRE(source, handler) \
+		STAP_PROBE2(dispatch, timer__fire, source, handler)
+
+#define DISPATCH_AFTER_FIRE_ENABLED() DISPATCH_SDT_ENABLED(after__fire)
+#define DISPATCH_AFTER_FIRE(queue, function, context) \
+		STAP_PROBE3(dispatch, after__fire, queue, function, context)
+
+#define DISPATCH_RUNTIME_EVENT_ENABLED() DISPATCH_SDT_ENABLED(runtime__event)
+#define DISPATCH_RUNTIME_EVENT(event, ptr, value) \
+		STAP_PROBE3(dispatch, runtime__event, event, ptr, value)
+
+#endif // __DISPATCH_PROVIDER_SDT__
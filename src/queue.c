@@ -19,6 +19,7 @@
  */
 
 #include "internal.h"
+#include "introspection_private.h" // dispatch_introspection_copy_stats
 #if HAVE_MACH
 #include "protocol.h" // _dispatch_send_wakeup_runloop_thread
 #endif
@@ -205,6 +206,10 @@ static void _dispatch_queue_override_invoke(dispatch_continuation_t dc,
 		dispatch_invoke_context_t dic, dispatch_invoke_flags_t flags);
 static void _dispatch_workloop_stealer_invoke(dispatch_continuation_t dc,
 		dispatch_invoke_context_t dic, dispatch_invoke_flags_t flags);
+#if DISPATCH_USE_CONTINUATION_DEADLINES
+static void _dispatch_async_deadline_invoke(dispatch_continuation_t dc,
+		dispatch_invoke_context_t dic, dispatch_invoke_flags_t flags);
+#endif
 
 const struct dispatch_continuation_vtable_s _dispatch_continuation_vtables[] = {
 	DC_VTABLE_ENTRY(ASYNC_REDIRECT,
@@ -219,6 +224,10 @@ const struct dispatch_continuation_vtable_s _dispatch_continuation_vtables[] = {
 	DC_VTABLE_ENTRY(MACH_ASYNC_REPLY,
 		.do_invoke = _dispatch_mach_msg_async_reply_invoke),
 #endif
+#if DISPATCH_USE_CONTINUATION_DEADLINES
+	DC_VTABLE_ENTRY(DEADLINE,
+		.do_invoke = _dispatch_async_deadline_invoke),
+#endif
 #if HAVE_PTHREAD_WORKQUEUE_QOS
 	DC_VTABLE_ENTRY(WORKLOOP_STEALING,
 		.do_invoke = _dispatch_workloop_stealer_invoke),
@@ -876,6 +885,114 @@ dispatch_async_enforce_qos_class_f(dispatch_queue_t dq, void *ctxt,
 	_dispatch_async_f(dq, ctxt, func, DISPATCH_BLOCK_ENFORCE_QOS_CLASS);
 }
 
+#pragma mark -
+#pragma mark dispatch_async_with_deadline
+
+static char const * const _dispatch_deadline_key = "deadline";
+
+// Deadlines are tracked as absolute DISPATCH_CLOCK_UPTIME values, which are
+// valid dispatch_time_t's and can be compared without converting clocks.
+DISPATCH_ALWAYS_INLINE
+static inline uint64_t
+_dispatch_deadline_current(void)
+{
+	dispatch_thread_context_t dtc;
+
+	dtc = _dispatch_thread_context_find(_dispatch_deadline_key);
+	return dtc ? dtc->dtc_deadline : DISPATCH_TIME_FOREVER;
+}
+
+static uint64_t
+_dispatch_deadline_from_time(dispatch_time_t when)
+{
+	dispatch_clock_t clock;
+	uint64_t value, now;
+
+	if (when == DISPATCH_TIME_FOREVER) {
+		return DISPATCH_TIME_FOREVER;
+	}
+	_dispatch_time_to_clock_and_value(when, &clock, &value);
+	if (clock == DISPATCH_CLOCK_UPTIME) {
+		return value;
+	}
+	value = _dispatch_timeout(when);
+	if (value == DISPATCH_TIME_FOREVER) {
+		return DISPATCH_TIME_FOREVER;
+	}
+	now = _dispatch_uptime();
+	value = _dispatch_time_nano2mach(value);
+	if (value >= DISPATCH_TIME_MAX_VALUE - now) {
+		return DISPATCH_TIME_FOREVER;
+	}
+	return now + value;
+}
+
+dispatch_time_t
+dispatch_get_current_deadline(void)
+{
+	return _dispatch_deadline_current();
+}
+
+#if DISPATCH_USE_CONTINUATION_DEADLINES
+static void
+_dispatch_async_deadline_invoke(dispatch_continuation_t dc,
+		DISPATCH_UNUSED dispatch_invoke_context_t dic,
+		dispatch_invoke_flags_t flags)
+{
+	uint64_t deadline = (uint64_t)(uintptr_t)dc->dc_data;
+	dispatch_function_t expired = dc->dc_other;
+	uintptr_t dc_flags = DC_FLAG_CONSUME;
+	dispatch_queue_t dq = _dispatch_queue_get_current();
+
+	_dispatch_continuation_pop_forwarded(dc, dc_flags, dq, {
+		dispatch_invoke_with_autoreleasepool(flags, {
+			if (unlikely(_dispatch_uptime() >= deadline)) {
+				// shed stale work without running it
+				_dispatch_trace_runtime_event(deadline_expired, dq, deadline);
+				if (expired) _dispatch_client_callout(dc->dc_ctxt, expired);
+			} else {
+				dispatch_thread_context_s dtc = {
+					.dtc_key = _dispatch_deadline_key,
+					.dtc_deadline = deadline,
+				};
+				_dispatch_thread_context_push(&dtc);
+				_dispatch_client_callout(dc->dc_ctxt, dc->dc_func);
+				_dispatch_thread_context_pop(&dtc);
+			}
+		});
+	});
+}
+#endif // DISPATCH_USE_CONTINUATION_DEADLINES
+
+DISPATCH_NOINLINE
+void
+dispatch_async_with_deadline_f(dispatch_queue_t dq, dispatch_time_t when,
+		void *ctxt, dispatch_function_t func, dispatch_function_t expired)
+{
+	uint64_t deadline = MIN(_dispatch_deadline_from_time(when),
+			_dispatch_deadline_current());
+
+	if (deadline == DISPATCH_TIME_FOREVER) {
+		return _dispatch_async_f(dq, ctxt, func, 0);
+	}
+#if DISPATCH_USE_CONTINUATION_DEADLINES
+	dispatch_continuation_t dc = _dispatch_continuation_alloc();
+	dispatch_qos_t qos;
+
+	// dc_other holds the expiration callback: initialize without
+	// DC_FLAG_CONSUME so that the continuation is never latency stamped,
+	// the DEADLINE vtable replaces the flags anyway
+	qos = _dispatch_continuation_init_f(dc, dq, ctxt, func, 0, 0);
+	dc->do_vtable = DC_VTABLE(DEADLINE);
+	dc->dc_data = (void *)(uintptr_t)deadline;
+	dc->dc_other = expired;
+	_dispatch_continuation_async(dq, dc, qos, DC_FLAG_CONSUME);
+#else
+	(void)expired;
+	_dispatch_async_f(dq, ctxt, func, 0);
+#endif
+}
+
 #ifdef __BLOCKS__
 void
 dispatch_async(dispatch_queue_t dq, dispatch_block_t work)
@@ -1088,6 +1205,9 @@ _dispatch_waiter_wake_wlh_anon(dispatch_sync_context_t dsc)
 		_dispatch_wqthread_override_start(dsc->dsc_waiter,
 				dsc->dsc_override_qos);
 	}
+#if DISPATCH_USE_SYNC_OWNER_BOOST
+	_dispatch_event_loop_end_boost(dsc);
+#endif
 	_dispatch_thread_event_signal(&dsc->dsc_event);
 }
 
@@ -1496,6 +1616,9 @@ _dispatch_async_and_wait_invoke(void *ctxt)
 	dsc->dsc_func = NULL;
 
 	if (dsc->dc_data == DISPATCH_WLH_ANON) {
+#if DISPATCH_USE_SYNC_OWNER_BOOST
+		_dispatch_event_loop_end_boost(dsc);
+#endif
 		_dispatch_thread_event_signal(&dsc->dsc_event); // release
 	} else {
 		_dispatch_event_loop_cancel_waiter(dsc);
@@ -1594,6 +1717,13 @@ __DISPATCH_WAIT_FOR_QUEUE__(dispatch_sync_context_t dsc, dispatch_queue_t dq)
 	dx_push(dq, dsc, _dispatch_qos_from_pp(dsc->dc_priority));
 	_dispatch_trace_runtime_event(sync_wait, dq, 0);
 	if (dsc->dc_data == DISPATCH_WLH_ANON) {
+#if DISPATCH_USE_SYNC_OWNER_BOOST
+		// lend our priority to whoever is draining `dq` until it reaches us
+		dq_state = os_atomic_load2o(dq, dq_state, relaxed);
+		if (_dq_state_drain_locked(dq_state)) {
+			_dispatch_event_loop_boost_owner(dsc, dq_state);
+		}
+#endif
 		_dispatch_thread_event_wait(&dsc->dsc_event); // acquire
 	} else {
 		_dispatch_event_loop_wait_for_ownership(dsc);
@@ -2164,6 +2294,8 @@ _dispatch_queue_specific_head_dispose(dispatch_queue_specific_head_t dqsh)
 	TAILQ_HEAD(, dispatch_queue_specific_s) entries =
 			TAILQ_HEAD_INITIALIZER(entries);
 
+	free(dqsh->dqsh_latency);
+	dqsh->dqsh_latency = NULL;
 	TAILQ_CONCAT(&entries, &dqsh->dqsh_entries, dqs_entry);
 	TAILQ_FOREACH_SAFE(dqs, &entries, dqs_entry, tmp) {
 		if (dqs->dqs_destructor) {
@@ -2181,14 +2313,22 @@ _dispatch_queue_specific_head_dispose(dispatch_queue_specific_head_t dqsh)
 	}
 }
 
-DISPATCH_NOINLINE
-static void
-_dispatch_queue_init_specific(dispatch_queue_t dq)
+static dispatch_queue_specific_head_t
+_dispatch_queue_specific_head_create(void)
 {
 	dispatch_queue_specific_head_t dqsh;
 
 	dqsh = _dispatch_calloc(1, sizeof(struct dispatch_queue_specific_head_s));
 	TAILQ_INIT(&dqsh->dqsh_entries);
+	return dqsh;
+}
+
+DISPATCH_NOINLINE
+static void
+_dispatch_queue_init_specific(dispatch_queue_t dq)
+{
+	dispatch_queue_specific_head_t dqsh = _dispatch_queue_specific_head_create();
+
 	if (unlikely(!os_atomic_cmpxchg2o(dq, dq_specific_head,
 			NULL, dqsh, release))) {
 		_dispatch_queue_specific_head_dispose(dqsh);
@@ -2684,6 +2824,11 @@ _dispatch_lane_create_with_target(const char *label, dispatch_queue_attr_t dqa,
 		dqf |= DQF_AUTORELEASE_ALWAYS;
 		break;
 	}
+#if DISPATCH_USE_QUEUE_LATENCY_TRACKING
+	if (dqai.dqai_latency_tracking) {
+		dqf |= DQF_LATENCY_TRACKING;
+	}
+#endif
 	if (label) {
 		const char *tmp = _dispatch_strdup_if_mutable(label);
 		if (tmp != label) {
@@ -2699,6 +2844,14 @@ _dispatch_lane_create_with_target(const char *label, dispatch_queue_attr_t dqa,
 			(dqai.dqai_inactive ? DISPATCH_QUEUE_INACTIVE : 0));
 
 	dq->dq_label = label;
+	if (dqf & DQF_LATENCY_TRACKING) {
+		dispatch_queue_specific_head_t dqsh;
+
+		dqsh = _dispatch_queue_specific_head_create();
+		dqsh->dqsh_latency = _dispatch_calloc(1,
+				sizeof(struct dispatch_queue_latency_s));
+		dq->dq_specific_head = dqsh;
+	}
 	dq->dq_priority = _dispatch_priority_make((dispatch_qos_t)dqai.dqai_qos,
 			dqai.dqai_relpri);
 	if (overcommit == _dispatch_queue_attr_overcommit_enabled) {
@@ -3366,6 +3519,182 @@ _dispatch_queue_merge_stats(uint64_t start, bool trace, perfmon_thread_type type
 
 #endif
 
+#pragma mark -
+#pragma mark dispatch_introspection_copy_stats
+
+dispatch_static_assert(DISPATCH_STATS_ROOT_QUEUE_COUNT ==
+		DISPATCH_ROOT_QUEUE_COUNT);
+dispatch_static_assert(DISPATCH_STATS_ROOT_QUEUE_COUNT ==
+		DISPATCH_INTROSPECTION_STATS_ROOT_QUEUE_COUNT);
+
+#if DISPATCH_USE_THREAD_STATS
+static struct {
+	dispatch_unfair_lock_s lock;
+	LIST_HEAD(, dispatch_thread_stats_s) threads;
+	// counters of the threads that exited
+	uint64_t retired[dispatch_stat_count];
+} _dispatch_thread_stats;
+
+void
+_dispatch_thread_stats_register(void)
+{
+	dispatch_thread_stats_t dts = &__dispatch_thread_stats;
+
+	if (dts->dts_registered) return;
+	_dispatch_unfair_lock_lock(&_dispatch_thread_stats.lock);
+	LIST_INSERT_HEAD(&_dispatch_thread_stats.threads, dts, dts_list);
+	_dispatch_unfair_lock_unlock(&_dispatch_thread_stats.lock);
+	dts->dts_registered = true;
+}
+
+void
+_dispatch_thread_stats_unregister(void)
+{
+	dispatch_thread_stats_t dts = &__dispatch_thread_stats;
+
+	if (!dts->dts_registered) return;
+	_dispatch_unfair_lock_lock(&_dispatch_thread_stats.lock);
+	LIST_REMOVE(dts, dts_list);
+	for (size_t i = 0; i < dispatch_stat_count; i++) {
+		_dispatch_thread_stats.retired[i] += dts->dts_counters[i];
+		dts->dts_counters[i] = 0;
+	}
+	_dispatch_unfair_lock_unlock(&_dispatch_thread_stats.lock);
+	dts->dts_registered = false;
+}
+#endif // DISPATCH_USE_THREAD_STATS
+
+size_t
+dispatch_introspection_copy_stats(dispatch_introspection_stats_t stats,
+		size_t size)
+{
+	uint64_t counters[dispatch_stat_count] = { };
+	dispatch_introspection_stats_s s;
+	size_t i;
+
+#if DISPATCH_USE_THREAD_STATS
+	dispatch_thread_stats_t dts;
+
+	_dispatch_unfair_lock_lock(&_dispatch_thread_stats.lock);
+	for (i = 0; i < dispatch_stat_count; i++) {
+		counters[i] = _dispatch_thread_stats.retired[i];
+	}
+	LIST_FOREACH(dts, &_dispatch_thread_stats.threads, dts_list) {
+		for (i = 0; i < dispatch_stat_count; i++) {
+			counters[i] += os_atomic_load(&dts->dts_counters[i], relaxed);
+		}
+	}
+	_dispatch_unfair_lock_unlock(&_dispatch_thread_stats.lock);
+#endif // DISPATCH_USE_THREAD_STATS
+
+	for (i = 0; i < DISPATCH_STATS_ROOT_QUEUE_COUNT; i++) {
+		s.root_queue_items_enqueued[i] = counters[dispatch_stat_enqueued + i];
+		s.root_queue_items_drained[i] = counters[dispatch_stat_drained + i];
+	}
+	s.threads_spawned = counters[dispatch_stat_thread_spawn];
+	s.threads_parked = counters[dispatch_stat_thread_park];
+	s.threads_reaped = counters[dispatch_stat_thread_reap];
+	s.contended_waits = counters[dispatch_stat_contended_wait];
+	s.continuation_cache_hits = counters[dispatch_stat_cache_hit];
+	s.continuation_cache_misses = counters[dispatch_stat_cache_miss];
+	s.timers_fired = counters[dispatch_stat_timer_fire];
+	s.event_loop_wakeups = counters[dispatch_stat_event_loop_wakeup];
+	s.object_slab_hits = counters[dispatch_stat_object_slab_hit];
+	s.object_slab_misses = counters[dispatch_stat_object_slab_miss];
+	s.object_slab_bytes_in_use =
+			counters[dispatch_stat_object_slab_bytes_alloc] -
+			counters[dispatch_stat_object_slab_bytes_free];
+#if DISPATCH_USE_OBJECT_SLABS
+	s.object_slab_bytes_reserved = _dispatch_object_slab_bytes_reserved();
+#else
+	s.object_slab_bytes_reserved = 0;
+#endif
+
+	if (size > sizeof(s)) size = sizeof(s);
+	memcpy(stats, &s, size);
+	return size;
+}
+
+#if DISPATCH_USE_QUEUE_LATENCY_TRACKING
+DISPATCH_ALWAYS_INLINE
+static inline size_t
+_dispatch_queue_latency_bucket(uint64_t nsec)
+{
+	const unsigned int shift = DISPATCH_QUEUE_LATENCY_SUB_BUCKET_SHIFT;
+	unsigned int exp;
+
+	if (nsec < DISPATCH_QUEUE_LATENCY_SUB_BUCKET_COUNT) {
+		return (size_t)nsec;
+	}
+	exp = 63 - (unsigned int)__builtin_clzll(nsec);
+	if (unlikely(exp > DISPATCH_QUEUE_LATENCY_MAX_EXP)) {
+		return DISPATCH_QUEUE_LATENCY_BUCKET_COUNT - 1;
+	}
+	return ((size_t)(exp - shift + 1) << shift) |
+			(size_t)((nsec >> (exp - shift)) &
+			(DISPATCH_QUEUE_LATENCY_SUB_BUCKET_COUNT - 1));
+}
+
+DISPATCH_NOINLINE
+void
+_dispatch_queue_latency_record(dispatch_queue_class_t dqu,
+		uint64_t enqueue_time, uint64_t start_time)
+{
+	dispatch_queue_t dq = dqu._dq;
+	uint64_t wait, run, end_time = _dispatch_uptime();
+	dispatch_queue_latency_t dql;
+
+	// stamped items are only expected to be popped by the queue they were
+	// pushed onto, but never trust dq_specific_head for other queues
+	if (!(_dispatch_queue_atomic_flags(dq) & DQF_LATENCY_TRACKING)) {
+		return;
+	}
+	dql = dq->dq_specific_head->dqsh_latency;
+	wait = _dispatch_time_mach2nano(start_time - enqueue_time);
+	run = _dispatch_time_mach2nano(end_time - start_time);
+
+	os_atomic_add2o(dql, dql_wait_total, wait, relaxed);
+	os_atomic_add2o(dql, dql_run_total, run, relaxed);
+	os_atomic_inc(&dql->dql_wait[_dispatch_queue_latency_bucket(wait)],
+			relaxed);
+	os_atomic_inc(&dql->dql_run[_dispatch_queue_latency_bucket(run)],
+			relaxed);
+}
+#endif // DISPATCH_USE_QUEUE_LATENCY_TRACKING
+
+size_t
+dispatch_introspection_queue_copy_latency(dispatch_queue_t dq,
+		dispatch_introspection_queue_latency_t latency, size_t size)
+{
+#if DISPATCH_USE_QUEUE_LATENCY_TRACKING
+	dispatch_introspection_queue_latency_s l;
+	dispatch_queue_latency_t dql;
+
+	dispatch_static_assert(DISPATCH_QUEUE_LATENCY_SUB_BUCKET_SHIFT ==
+			DISPATCH_INTROSPECTION_LATENCY_SUB_BUCKET_SHIFT);
+	dispatch_static_assert(DISPATCH_QUEUE_LATENCY_BUCKET_COUNT ==
+			DISPATCH_INTROSPECTION_LATENCY_BUCKET_COUNT);
+
+	if (!(_dispatch_queue_atomic_flags(dq) & DQF_LATENCY_TRACKING)) {
+		return 0;
+	}
+	dql = dq->dq_specific_head->dqsh_latency;
+	l.wait_total = os_atomic_load2o(dql, dql_wait_total, relaxed);
+	l.run_total = os_atomic_load2o(dql, dql_run_total, relaxed);
+	for (size_t i = 0; i < DISPATCH_QUEUE_LATENCY_BUCKET_COUNT; i++) {
+		l.wait[i] = os_atomic_load(&dql->dql_wait[i], relaxed);
+		l.run[i] = os_atomic_load(&dql->dql_run[i], relaxed);
+	}
+
+	if (size > sizeof(l)) size = sizeof(l);
+	memcpy(latency, &l, size);
+	return size;
+#else
+	(void)dq; (void)latency; (void)size;
+	return 0;
+#endif
+}
+
 #pragma mark -
 #pragma mark dispatch queue/lane drain & invoke
 
@@ -3420,6 +3749,11 @@ _dispatch_queue_drain_init_narrowing_check_deadline(dispatch_invoke_context_t di
 	if (!(pri & DISPATCH_PRIORITY_FLAG_OVERCOMMIT)) {
 		dic->dic_next_narrow_check = _dispatch_approximate_time() +
 				_dispatch_narrow_check_interval();
+#if DISPATCH_USE_INTERNAL_WORKQUEUE
+		// there is no thread QoS to derive the pool from, remember the one
+		// of the root queue being drained
+		dic->dic_narrow_priority = pri;
+#endif
 	}
 }
 
@@ -3429,11 +3763,16 @@ _dispatch_queue_drain_should_narrow_slow(uint64_t now,
 		dispatch_invoke_context_t dic)
 {
 	if (dic->dic_next_narrow_check != DISPATCH_THREAD_IS_NARROWING) {
+#if DISPATCH_USE_INTERNAL_WORKQUEUE
+		dispatch_qos_t qos = _dispatch_priority_qos(dic->dic_narrow_priority);
+		if (qos == DISPATCH_QOS_UNSPECIFIED) qos = DISPATCH_QOS_DEFAULT;
+#else
 		pthread_priority_t pp = _dispatch_get_priority();
 		dispatch_qos_t qos = _dispatch_qos_from_pp(pp);
 		if (unlikely(qos < DISPATCH_QOS_MIN || qos > DISPATCH_QOS_MAX)) {
 			DISPATCH_CLIENT_CRASH(pp, "Thread QoS corruption");
 		}
+#endif
 		size_t idx = DISPATCH_QOS_BUCKET(qos);
 		os_atomic(uint64_t) *deadline = &_dispatch_narrowing_deadlines[idx];
 		uint64_t oldval, newval = now + _dispatch_narrow_check_interval();
@@ -3445,9 +3784,16 @@ _dispatch_queue_drain_should_narrow_slow(uint64_t now,
 			}
 		});
 
+#if DISPATCH_USE_INTERNAL_WORKQUEUE
+		if (!_dispatch_workq_should_narrow(_dispatch_get_root_queue(qos,
+				false))) {
+			return false;
+		}
+#else
 		if (!_pthread_workqueue_should_narrow(pp)) {
 			return false;
 		}
+#endif
 		dic->dic_next_narrow_check = DISPATCH_THREAD_IS_NARROWING;
 	}
 	return true;
@@ -3749,6 +4095,140 @@ _dispatch_lane_invoke(dispatch_lane_t dq, dispatch_invoke_context_t dic,
 	_dispatch_queue_class_invoke(dq, dic, flags, 0, _dispatch_lane_invoke2);
 }
 
+#pragma mark -
+#pragma mark dispatch_strand_t
+
+#define _dispatch_strand_items(dstr) os_mpsc(dstr, dstr_items)
+
+dispatch_strand_t
+dispatch_strand_create(dispatch_queue_t tq)
+{
+	dispatch_strand_t dstr;
+
+	if (!tq) {
+		tq = _dispatch_get_default_queue(false);
+	} else {
+		_dispatch_retain(tq);
+	}
+	dstr = _dispatch_object_alloc(DISPATCH_VTABLE(strand),
+			sizeof(struct dispatch_strand_s));
+	dstr->do_next = DISPATCH_OBJECT_LISTLESS;
+	dstr->do_targetq = tq;
+	_dispatch_object_debug(dstr, "%s", __func__);
+	return dstr;
+}
+
+DISPATCH_NOINLINE
+static void
+_dispatch_strand_schedule(dispatch_strand_t dstr, dispatch_qos_t qos)
+{
+	dispatch_queue_t tq = dstr->do_targetq;
+
+	// consumed by _dispatch_strand_invoke() when it gives the bit up
+	_dispatch_retain(dstr);
+	if (!qos) qos = _dispatch_priority_qos(tq->dq_priority);
+	dx_push(tq, dstr, qos);
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_strand_push(dispatch_strand_t dstr, dispatch_object_t dou,
+		dispatch_qos_t qos)
+{
+	_dispatch_trace_item_push(dstr->do_targetq, dou);
+	if (os_mpsc_push_item(_dispatch_strand_items(dstr), dou._do, do_next)) {
+		// pairs with the exchange in _dispatch_strand_invoke()
+		if (!os_atomic_xchg2o(dstr, dstr_scheduled, true, acq_rel)) {
+			_dispatch_strand_schedule(dstr, qos);
+		}
+	}
+}
+
+void
+dispatch_strand_async_f(dispatch_strand_t dstr, void *ctxt,
+		dispatch_function_t func)
+{
+	dispatch_continuation_t dc = _dispatch_continuation_alloc();
+	uintptr_t dc_flags = DC_FLAG_CONSUME;
+	dispatch_qos_t qos;
+
+	qos = _dispatch_continuation_init_f(dc, dstr->do_targetq, ctxt, func, 0,
+			dc_flags);
+	_dispatch_strand_push(dstr, dc, qos);
+}
+
+#ifdef __BLOCKS__
+void
+dispatch_strand_async(dispatch_strand_t dstr, dispatch_block_t work)
+{
+	dispatch_continuation_t dc = _dispatch_continuation_alloc();
+	uintptr_t dc_flags = DC_FLAG_CONSUME;
+	dispatch_qos_t qos;
+
+	qos = _dispatch_continuation_init(dc, dstr->do_targetq, work, 0,
+			dc_flags);
+	_dispatch_strand_push(dstr, dc, qos);
+}
+#endif
+
+DISPATCH_NOINLINE
+void
+_dispatch_strand_invoke(dispatch_strand_t dstr,
+		dispatch_invoke_context_t dic, dispatch_invoke_flags_t flags)
+{
+	dispatch_queue_t tq = dstr->do_targetq;
+	struct dispatch_object_s *dc, *next_dc;
+
+	dstr->do_next = DISPATCH_OBJECT_LISTLESS;
+again:
+	dc = os_mpsc_get_head(_dispatch_strand_items(dstr));
+	do {
+		// the item is popped before it is invoked because it is freed by
+		// its invocation, dstr_scheduled keeps other threads out meanwhile
+		next_dc = os_mpsc_pop_head(_dispatch_strand_items(dstr), dc, do_next);
+		_dispatch_continuation_pop_inline(dc, dic, flags, tq);
+		if (next_dc && unlikely(_dispatch_queue_drain_should_narrow(dic))) {
+			// yield the thread, the strand stays scheduled
+			return dx_push(tq, dstr, _dispatch_priority_qos(tq->dq_priority));
+		}
+	} while ((dc = next_dc));
+
+	// A producer that found the list empty while the bit was still set
+	// didn't schedule the strand, the exchange orders its push before our
+	// emptiness check below.
+	(void)os_atomic_xchg2o(dstr, dstr_scheduled, false, acq_rel);
+	if (unlikely(!os_mpsc_looks_empty(_dispatch_strand_items(dstr)))) {
+		if (!os_atomic_xchg2o(dstr, dstr_scheduled, true, acq_rel)) {
+			goto again;
+		}
+	}
+	_dispatch_release_tailcall(dstr);
+}
+
+void
+_dispatch_strand_dispose(dispatch_strand_t dstr,
+		DISPATCH_UNUSED bool *allow_free)
+{
+	if (unlikely(!os_mpsc_looks_empty(_dispatch_strand_items(dstr)))) {
+		DISPATCH_INTERNAL_CRASH(dstr->dstr_items_tail,
+				"Release of a strand with pending work items");
+	}
+}
+
+size_t
+_dispatch_strand_debug(dispatch_strand_t dstr, char *buf, size_t bufsiz)
+{
+	size_t offset = 0;
+	offset += dsnprintf(&buf[offset], bufsiz - offset, "%s[%p] = { ",
+			_dispatch_object_class_name(dstr), dstr);
+	offset += _dispatch_object_debug_attr(dstr, &buf[offset], bufsiz - offset);
+	offset += dsnprintf(&buf[offset], bufsiz - offset,
+			"scheduled = %d, items = %p }",
+			os_atomic_load2o(dstr, dstr_scheduled, relaxed),
+			dstr->dstr_items_head);
+	return offset;
+}
+
 #pragma mark -
 #pragma mark dispatch_workloop_t
 
@@ -4061,7 +4541,11 @@ _dispatch_workloop_dispose(dispatch_workloop_t dwl, bool *allow_free)
 		for (size_t i = 0; i < DISPATCH_TIMER_WLH_COUNT; i++) {
 			dispatch_assert(dwl->dwl_timer_heap[i].dth_count == 0);
 		}
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+		_dispatch_event_loop_workloop_timer_heap_dispose(dwl->dwl_timer_heap);
+#else
 		free(dwl->dwl_timer_heap);
+#endif
 		dwl->dwl_timer_heap = NULL;
 	}
 
@@ -5577,6 +6061,7 @@ _dispatch_root_queue_poke_slow(dispatch_queue_global_t dq, int n, int floor)
 			}
 			_dispatch_temporary_resource_shortage();
 		}
+		_dispatch_stats_inc(dispatch_stat_thread_spawn);
 	} while (--remaining);
 #else
 	(void)floor;
@@ -5645,6 +6130,7 @@ __DISPATCH_ROOT_QUEUE_CONTENDED_WAIT__(dispatch_queue_global_t dq,
 	int status = DISPATCH_ROOT_QUEUE_DRAIN_READY;
 	bool pending = false;
 
+	_dispatch_stats_inc(dispatch_stat_contended_wait);
 	do {
 		// Spin for a short while in case the contention is temporary -- e.g.
 		// when starting up after dispatch_apply, or when executing a few
@@ -5855,6 +6341,7 @@ _dispatch_root_queue_drain(dispatch_queue_global_t dq,
 	_dispatch_queue_drain_init_narrowing_check_deadline(&dic, pri);
 	_dispatch_perfmon_start();
 	while (likely(item = _dispatch_root_queue_drain_one(dq))) {
+		_dispatch_root_queue_stats_add(dq, dispatch_stat_drained, 1);
 		if (reset) _dispatch_wqthread_override_reset();
 		_dispatch_continuation_pop_inline(item, &dic, flags, dq);
 		reset = _dispatch_reset_basepri_override();
@@ -5990,8 +6477,10 @@ _dispatch_worker_thread(void *context)
 		_dispatch_root_queue_drain(dq, pri, DISPATCH_INVOKE_REDIRECTING_DRAIN);
 		_dispatch_reset_priority_and_voucher(pp, NULL);
 		_dispatch_trace_runtime_event(worker_park, NULL, 0);
+		_dispatch_stats_inc(dispatch_stat_thread_park);
 	} while (dispatch_semaphore_wait(&pqc->dpq_thread_mediator,
 			dispatch_time(0, timeout)) == 0);
+	_dispatch_stats_inc(dispatch_stat_thread_reap);
 
 #if DISPATCH_USE_INTERNAL_WORKQUEUE
 	if (monitored) _dispatch_workq_worker_unregister(dq);
@@ -6965,6 +7454,7 @@ libdispatch_init(void)
 	_os_object_init();
 	_voucher_init();
 	_dispatch_introspection_init();
+	_dispatch_trace_buffer_init();
 }
 
 #if DISPATCH_USE_THREAD_LOCAL_STORAGE
@@ -7024,6 +7514,13 @@ _libdispatch_tsd_cleanup(void *ctx)
 	_tsd_call_cleanup(dispatch_voucher_key, _voucher_thread_cleanup);
 	_tsd_call_cleanup(dispatch_deferred_items_key,
 			_dispatch_deferred_items_cleanup);
+#if DISPATCH_USE_THREAD_STATS
+	_dispatch_thread_stats_unregister();
+#endif
+#if DISPATCH_USE_OBJECT_SLABS
+	_dispatch_object_slab_thread_cleanup();
+#endif
+	_dispatch_trace_buffer_unregister();
 #ifdef __ANDROID__
 	if (_dispatch_thread_detach_callback) {
 		_dispatch_thread_detach_callback();
@@ -7038,6 +7535,9 @@ libdispatch_tsd_init(void)
 {
 	pthread_setspecific(__dispatch_tsd_key, &__dispatch_tsd);
 	__dispatch_tsd.tid = gettid();
+#if DISPATCH_USE_THREAD_STATS
+	_dispatch_thread_stats_register();
+#endif
 }
 #endif
 
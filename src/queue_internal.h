@@ -46,6 +46,7 @@ DISPATCH_ENUM(dispatch_queue_flags, uint32_t,
 	DQF_LABEL_NEEDS_FREE    = 0x00200000, // queue label was strdup()ed
 	DQF_MUTABLE             = 0x00400000,
 	DQF_RELEASED            = 0x00800000, // xref_cnt == -1
+	DQF_LATENCY_TRACKING    = 0x01000000, // see dispatch_queue_latency_s
 
 	//
 	// Only applies to sources
@@ -456,9 +457,43 @@ typedef struct dispatch_queue_specific_s {
 	TAILQ_ENTRY(dispatch_queue_specific_s) dqs_entry;
 } *dispatch_queue_specific_t;
 
+/*
+ * Queue latency histograms
+ *
+ * Queues created with dispatch_queue_attr_make_with_latency_tracking() stamp
+ * the continuations pushed onto them with their enqueue time, and record how
+ * long they waited in the queue and how long they ran into these log-linear
+ * histograms when they are popped.
+ *
+ * Values are bucketed HDR-style: values below 2^SHIFT nanoseconds get one
+ * bucket each, then every power of two range is split in 2^SHIFT linear
+ * sub-buckets, which bounds the relative error to 1/2^SHIFT. Values of
+ * 2^(MAX_EXP + 1) nanoseconds (about 4.9 hours) or more land in the last
+ * bucket.
+ *
+ * The histograms hang off the dispatch_queue_specific_head_s of the queue,
+ * which is allocated when the queue is created and never changes after that.
+ */
+#define DISPATCH_QUEUE_LATENCY_SUB_BUCKET_SHIFT 3
+#define DISPATCH_QUEUE_LATENCY_SUB_BUCKET_COUNT \
+		(1u << DISPATCH_QUEUE_LATENCY_SUB_BUCKET_SHIFT)
+#define DISPATCH_QUEUE_LATENCY_MAX_EXP 43
+#define DISPATCH_QUEUE_LATENCY_BUCKET_COUNT \
+		((DISPATCH_QUEUE_LATENCY_MAX_EXP - \
+		DISPATCH_QUEUE_LATENCY_SUB_BUCKET_SHIFT + 2) << \
+		DISPATCH_QUEUE_LATENCY_SUB_BUCKET_SHIFT)
+
+typedef struct dispatch_queue_latency_s {
+	uint64_t volatile dql_wait_total;
+	uint64_t volatile dql_run_total;
+	uint64_t volatile dql_wait[DISPATCH_QUEUE_LATENCY_BUCKET_COUNT];
+	uint64_t volatile dql_run[DISPATCH_QUEUE_LATENCY_BUCKET_COUNT];
+} *dispatch_queue_latency_t;
+
 typedef struct dispatch_queue_specific_head_s {
 	dispatch_unfair_lock_s dqsh_lock;
 	TAILQ_HEAD(, dispatch_queue_specific_s) dqsh_entries;
+	dispatch_queue_latency_t dqsh_latency;
 } *dispatch_queue_specific_head_t;
 
 #define DISPATCH_WORKLOOP_ATTR_HAS_SCHED 0x1u
@@ -719,6 +754,7 @@ typedef struct dispatch_thread_context_s {
 		dispatch_io_t dtc_io_in_barrier;
 		union firehose_buffer_u *dtc_fb;
 		void *dtc_mig_demux_ctx;
+		uint64_t dtc_deadline;
 	};
 } dispatch_thread_context_s;
 
@@ -866,6 +902,31 @@ extern struct dispatch_queue_global_s _dispatch_root_queues[]; // serials 4 - 15
 #define DISPATCH_ASSERT_ON_MANAGER_QUEUE()
 #endif
 
+#pragma mark -
+#pragma mark dispatch_strand_t
+
+/*
+ * A strand is only an MPSC list of work items and a "scheduled" bit. The
+ * producer that makes the list non empty and wins the bit pushes the strand
+ * on its target queue (with an internal reference), where it is drained
+ * inline. The drainer gives the bit up once the list is empty, then checks
+ * the list again, so that the push of a producer that saw the bit still set
+ * is never lost.
+ */
+DISPATCH_CLASS_DECL(strand, OBJECT);
+struct dispatch_strand_s {
+	DISPATCH_OBJECT_HEADER(strand);
+	struct dispatch_object_s *volatile dstr_items_head;
+	struct dispatch_object_s *volatile dstr_items_tail;
+	bool volatile dstr_scheduled;
+};
+
+void _dispatch_strand_invoke(dispatch_strand_t dstr,
+		dispatch_invoke_context_t dic, dispatch_invoke_flags_t flags);
+void _dispatch_strand_dispose(dispatch_strand_t dstr, bool *allow_free);
+size_t _dispatch_strand_debug(dispatch_strand_t dstr, char *buf,
+		size_t bufsiz);
+
 #pragma mark -
 #pragma mark dispatch_queue_attr_t
 
@@ -881,6 +942,7 @@ typedef struct dispatch_queue_attr_info_s {
 	uint16_t dqai_autorelease_frequency:2;
 	uint16_t dqai_concurrent:1;
 	uint16_t dqai_inactive:1;
+	uint16_t dqai_latency_tracking:1;
 } dispatch_queue_attr_info_t;
 
 typedef enum {
@@ -901,7 +963,10 @@ typedef enum {
 
 #define DISPATCH_QUEUE_ATTR_INACTIVE_COUNT 2
 
+#define DISPATCH_QUEUE_ATTR_LATENCY_TRACKING_COUNT 2
+
 #define DISPATCH_QUEUE_ATTR_COUNT  ( \
+		DISPATCH_QUEUE_ATTR_LATENCY_TRACKING_COUNT * \
 		DISPATCH_QUEUE_ATTR_OVERCOMMIT_COUNT * \
 		DISPATCH_QUEUE_ATTR_AUTORELEASE_FREQUENCY_COUNT * \
 		DISPATCH_QUEUE_ATTR_QOS_COUNT * \
@@ -1008,6 +1073,8 @@ dispatch_queue_attr_info_t _dispatch_queue_attr_to_info(dispatch_queue_attr_t);
 // continuation is an internal implementation detail that should not be
 // introspected
 #define DC_FLAG_NO_INTROSPECTION		0x200ul
+// continuation has its enqueue time in dc_other, see DQF_LATENCY_TRACKING
+#define DC_FLAG_LATENCY_STAMP			0x400ul
 // never set on continuations, used by mach.c only
 #define DC_FLAG_MACH_BARRIER		0x1000000ul
 
@@ -1026,6 +1093,9 @@ typedef struct dispatch_sync_context_s {
 	dispatch_thread_frame_s dsc_dtf;
 	dispatch_thread_event_s dsc_event;
 	dispatch_tid dsc_waiter;
+#if DISPATCH_USE_SYNC_OWNER_BOOST
+	dispatch_tid volatile dsc_boosted_owner;
+#endif
 	uint8_t dsc_override_qos_floor;
 	uint8_t dsc_override_qos;
 	uint16_t dsc_autorelease : 2;
@@ -1058,6 +1128,10 @@ void _dispatch_continuation_free_to_heap(dispatch_continuation_t c);
 void _dispatch_continuation_pop(dispatch_object_t dou,
 		dispatch_invoke_context_t dic, dispatch_invoke_flags_t flags,
 		dispatch_queue_class_t dqu);
+#if DISPATCH_USE_QUEUE_LATENCY_TRACKING
+void _dispatch_queue_latency_record(dispatch_queue_class_t dqu,
+		uint64_t enqueue_time, uint64_t start_time);
+#endif
 
 #if DISPATCH_USE_MEMORYPRESSURE_SOURCE
 extern int _dispatch_continuation_cache_limit;
@@ -1078,6 +1152,9 @@ enum {
 	DC_MACH_SEND_BARRIER_TYPE,
 	DC_MACH_RECV_BARRIER_TYPE,
 	DC_MACH_ASYNC_REPLY_TYPE,
+#if DISPATCH_USE_CONTINUATION_DEADLINES
+	DC_DEADLINE_TYPE,
+#endif
 #if HAVE_PTHREAD_WORKQUEUE_QOS
 	DC_WORKLOOP_STEALING_TYPE,
 	DC_OVERRIDE_STEALING_TYPE,
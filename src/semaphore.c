@@ -176,6 +176,31 @@ _dispatch_group_create_and_enter(void)
 	return _dispatch_group_create_with_count(1);
 }
 
+dispatch_group_t
+dispatch_group_create_sharded(void)
+{
+	dispatch_group_t dg = _dispatch_group_create_with_count(0);
+	uint32_t ncpus = dispatch_hw_config(logical_cpus);
+	uint32_t count = 1;
+	void *shards;
+
+	while (count < ncpus && count < DISPATCH_GROUP_SHARD_COUNT_MAX) {
+		count <<= 1;
+	}
+	if (count == 1) {
+		return dg;
+	}
+
+	size_t size = count * sizeof(struct dispatch_group_shard_s);
+	while (unlikely(posix_memalign(&shards, DISPATCH_CACHELINE_SIZE, size))) {
+		_dispatch_temporary_resource_shortage();
+	}
+	memset(shards, 0, size);
+	dg->dg_shards = shards;
+	dg->dg_shard_mask = count - 1;
+	return dg;
+}
+
 void
 _dispatch_group_dispose(dispatch_object_t dou, DISPATCH_UNUSED bool *allow_free)
 {
@@ -185,6 +210,7 @@ _dispatch_group_dispose(dispatch_object_t dou, DISPATCH_UNUSED bool *allow_free)
 		DISPATCH_CLIENT_CRASH((uintptr_t)dg_state,
 				"Group object deallocated while in use");
 	}
+	free(dou._dg->dg_shards);
 }
 
 size_t
@@ -192,16 +218,25 @@ _dispatch_group_debug(dispatch_object_t dou, char *buf, size_t bufsiz)
 {
 	dispatch_group_t dg = dou._dg;
 	uint64_t dg_state = os_atomic_load2o(dg, dg_state, relaxed);
+	uint32_t count = _dg_state_value(dg_state);
+
+	if (dg->dg_shards) {
+		count = 0;
+		for (uint32_t i = 0; i <= dg->dg_shard_mask; i++) {
+			count += os_atomic_load2o(&dg->dg_shards[i], dgs_count, relaxed);
+		}
+	}
 
 	size_t offset = 0;
 	offset += dsnprintf(&buf[offset], bufsiz - offset, "%s[%p] = { ",
 			_dispatch_object_class_name(dg), dg);
 	offset += _dispatch_object_debug_attr(dg, &buf[offset], bufsiz - offset);
 	offset += dsnprintf(&buf[offset], bufsiz - offset,
-			"count = %d, gen = %d, waiters = %d, notifs = %d }",
-			_dg_state_value(dg_state), _dg_state_gen(dg_state),
+			"count = %d, gen = %d, waiters = %d, notifs = %d, shards = %d }",
+			count, _dg_state_gen(dg_state),
 			(bool)(dg_state & DISPATCH_GROUP_HAS_WAITERS),
-			(bool)(dg_state & DISPATCH_GROUP_HAS_NOTIFS));
+			(bool)(dg_state & DISPATCH_GROUP_HAS_NOTIFS),
+			dg->dg_shards ? dg->dg_shard_mask + 1 : 0);
 	return offset;
 }
 
@@ -256,6 +291,7 @@ _dispatch_group_wake(dispatch_group_t dg, uint64_t dg_state, bool needs_release)
 		do {
 			dispatch_queue_t dsn_queue = (dispatch_queue_t)dc->dc_data;
 			next_dc = os_mpsc_pop_snapshot_head(dc, tail, do_next);
+			_dispatch_continuation_latency_restamp(dc);
 			_dispatch_continuation_async(dsn_queue, dc,
 					_dispatch_qos_from_pp(dc->dc_priority), dc->dc_flags);
 			_dispatch_release(dsn_queue);
@@ -271,8 +307,9 @@ _dispatch_group_wake(dispatch_group_t dg, uint64_t dg_state, bool needs_release)
 	if (refs) _dispatch_release_n(dg, refs);
 }
 
-void
-dispatch_group_leave(dispatch_group_t dg)
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_group_leave_inline(dispatch_group_t dg)
 {
 	// The value is incremented on a 64bits wide atomic so that the carry for
 	// the -1 -> 0 transition increments the generation atomically.
@@ -305,8 +342,9 @@ dispatch_group_leave(dispatch_group_t dg)
 	}
 }
 
-void
-dispatch_group_enter(dispatch_group_t dg)
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_group_enter_inline(dispatch_group_t dg)
 {
 	// The value is decremented on a 32bits wide atomic so that the carry
 	// for the 0 -> -1 transition is not propagated to the upper 32bits.
@@ -322,6 +360,93 @@ dispatch_group_enter(dispatch_group_t dg)
 	}
 }
 
+DISPATCH_NOINLINE
+static void
+_dispatch_group_sharded_enter(dispatch_group_t dg)
+{
+	dispatch_group_shard_t dgs;
+	uint32_t count;
+
+	dgs = &dg->dg_shards[_dispatch_cpu_number() & dg->dg_shard_mask];
+	count = os_atomic_load2o(dgs, dgs_count, relaxed);
+	for (;;) {
+		if (likely(count)) {
+			if (unlikely(count == UINT32_MAX)) {
+				DISPATCH_CLIENT_CRASH(count,
+						"Too many nested calls to dispatch_group_enter()");
+			}
+			if (os_atomic_cmpxchgv2o(dgs, dgs_count, count, count + 1,
+					&count, acquire)) {
+				return;
+			}
+			continue;
+		}
+		// The shard becomes non zero: arrive at the group state first so that
+		// it never undercounts the non zero shards, and undo that arrival if
+		// another thread made the shard non zero meanwhile.
+		_dispatch_group_enter_inline(dg);
+		if (likely(os_atomic_cmpxchgv2o(dgs, dgs_count, 0, 1,
+				&count, acquire))) {
+			return;
+		}
+		_dispatch_group_leave_inline(dg);
+	}
+}
+
+DISPATCH_NOINLINE
+static void
+_dispatch_group_sharded_leave(dispatch_group_t dg)
+{
+	uint32_t mask = dg->dg_shard_mask;
+	uint32_t cpu = _dispatch_cpu_number();
+	dispatch_group_shard_t dgs;
+	uint32_t count;
+
+	for (uint32_t i = 0; ; i++) {
+		if (unlikely(i > mask)) {
+			// Every shard was seen empty, which for a balanced leave only
+			// happens while a concurrent dispatch_group_enter() publishes its
+			// count after having arrived at the group state.
+			uint64_t dg_state = os_atomic_load2o(dg, dg_state, relaxed);
+			if (unlikely(_dg_state_value(dg_state) == 0)) {
+				DISPATCH_CLIENT_CRASH((uintptr_t)dg_state,
+						"Unbalanced call to dispatch_group_leave()");
+			}
+			dispatch_hardware_pause();
+			i = 0;
+		}
+		dgs = &dg->dg_shards[(cpu + i) & mask];
+		count = os_atomic_load2o(dgs, dgs_count, relaxed);
+		while (count) {
+			// acq_rel so that the thread making the shard zero publishes the
+			// work of every thread that decremented it before
+			if (os_atomic_cmpxchgv2o(dgs, dgs_count, count, count - 1,
+					&count, acq_rel)) {
+				if (count == 1) _dispatch_group_leave_inline(dg);
+				return;
+			}
+		}
+	}
+}
+
+void
+dispatch_group_leave(dispatch_group_t dg)
+{
+	if (unlikely(dg->dg_shards)) {
+		return _dispatch_group_sharded_leave(dg);
+	}
+	_dispatch_group_leave_inline(dg);
+}
+
+void
+dispatch_group_enter(dispatch_group_t dg)
+{
+	if (unlikely(dg->dg_shards)) {
+		return _dispatch_group_sharded_enter(dg);
+	}
+	_dispatch_group_enter_inline(dg);
+}
+
 DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_group_notify(dispatch_group_t dg, dispatch_queue_t dq,
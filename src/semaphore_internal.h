@@ -70,6 +70,29 @@ struct dispatch_semaphore_s {
 #define DISPATCH_GROUP_VALUE_MAX        DISPATCH_GROUP_VALUE_INTERVAL
 #define DISPATCH_GROUP_HAS_NOTIFS       0x0000000000000002ULL
 #define DISPATCH_GROUP_HAS_WAITERS      0x0000000000000001ULL
+
+/*
+ * Sharded Groups:
+ *
+ * Groups made with dispatch_group_create_sharded() count enters and leaves in
+ * per-CPU shards, each on its own cacheline. The value of dg_state then only
+ * counts the shards that are non zero, in the fashion of a SNZI (scalable
+ * non-zero indicator): a shard arrives at dg_state before its count goes from
+ * 0 to 1, and departs from it after its count went from 1 to 0. dg_state can
+ * overcount the non zero shards while these transitions are in flight but
+ * never undercounts them, so it reaches 0 only when every enter has been
+ * balanced, and waiters and notifications work unchanged.
+ *
+ * A leave decrements the shard of the current CPU if it is non zero and
+ * otherwise any other non zero shard, since work items often complete on a
+ * different CPU than the one they were submitted from.
+ */
+#define DISPATCH_GROUP_SHARD_COUNT_MAX  64u
+
+typedef struct dispatch_group_shard_s {
+	uint32_t volatile dgs_count;
+} DISPATCH_CACHELINE_ALIGN *dispatch_group_shard_t;
+
 DISPATCH_CLASS_DECL(group, OBJECT);
 struct dispatch_group_s {
 	DISPATCH_OBJECT_HEADER(group);
@@ -79,6 +102,8 @@ struct dispatch_group_s {
 	) DISPATCH_ATOMIC64_ALIGN;
 	struct dispatch_continuation_s *volatile dg_notify_head;
 	struct dispatch_continuation_s *volatile dg_notify_tail;
+	dispatch_group_shard_t dg_shards;
+	uint32_t dg_shard_mask;
 };
 
 DISPATCH_ALWAYS_INLINE
@@ -96,4 +96,65 @@ void _dispatch_queue_merge_stats(uint64_t start, bool trace, perfmon_thread_type
 
 #endif // DISPATCH_PERF_MON
 
+#ifndef DISPATCH_USE_THREAD_STATS
+#if DISPATCH_USE_THREAD_LOCAL_STORAGE
+#define DISPATCH_USE_THREAD_STATS 1
+#else
+#define DISPATCH_USE_THREAD_STATS 0
+#endif
+#endif // !defined(DISPATCH_USE_THREAD_STATS)
+
+/*
+ * Always-on scheduler counters, reported by dispatch_introspection_copy_stats()
+ *
+ * Every thread only ever increments its own counter block, with plain loads
+ * and stores, the blocks are summed on demand.
+ */
+#define DISPATCH_STATS_ROOT_QUEUE_COUNT (DISPATCH_QOS_NBUCKETS * 2)
+
+typedef enum {
+	dispatch_stat_thread_spawn,
+	dispatch_stat_thread_park,
+	dispatch_stat_thread_reap,
+	dispatch_stat_contended_wait,
+	dispatch_stat_cache_hit,
+	dispatch_stat_cache_miss,
+	dispatch_stat_timer_fire,
+	dispatch_stat_event_loop_wakeup,
+	dispatch_stat_object_slab_hit,
+	dispatch_stat_object_slab_miss,
+	dispatch_stat_object_slab_bytes_alloc,
+	dispatch_stat_object_slab_bytes_free,
+	dispatch_stat_enqueued,
+	dispatch_stat_drained = dispatch_stat_enqueued +
+			DISPATCH_STATS_ROOT_QUEUE_COUNT,
+	dispatch_stat_count = dispatch_stat_drained +
+			DISPATCH_STATS_ROOT_QUEUE_COUNT,
+} dispatch_stat_t;
+
+#if DISPATCH_USE_THREAD_STATS
+typedef struct dispatch_thread_stats_s {
+	uint64_t dts_counters[dispatch_stat_count];
+	LIST_ENTRY(dispatch_thread_stats_s) dts_list;
+	bool dts_registered;
+} *dispatch_thread_stats_t;
+
+extern __thread struct dispatch_thread_stats_s __dispatch_thread_stats;
+
+void _dispatch_thread_stats_register(void);
+void _dispatch_thread_stats_unregister(void);
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_stats_add(dispatch_stat_t stat, unsigned long n)
+{
+	uint64_t *counter = &__dispatch_thread_stats.dts_counters[stat];
+	os_atomic_store(counter, os_atomic_load(counter, relaxed) + n, relaxed);
+}
+#else
+#define _dispatch_stats_add(stat, n) ((void)(stat), (void)(n))
+#endif // DISPATCH_USE_THREAD_STATS
+
+#define _dispatch_stats_inc(stat) _dispatch_stats_add(stat, 1)
+
 #endif
@@ -21,6 +21,7 @@
 #include "internal.h"
 
 static void _dispatch_source_handler_free(dispatch_source_refs_t ds, long kind);
+static void _dispatch_source_vector_dispose(dispatch_source_refs_t dr);
 
 #pragma mark -
 #pragma mark dispatch_source_t
@@ -38,10 +39,49 @@ _dispatch_source_get_handler(dispatch_source_refs_t dr, long kind)
 #define _dispatch_source_get_registration_handler(dr) \
 		_dispatch_source_get_handler(dr, DS_REGISTN_HANDLER)
 
+#if DISPATCH_USE_INLINE_SOURCE_REFS
+#define DISPATCH_SOURCE_INLINE_REFS_OFFSET \
+		roundup(sizeof(struct dispatch_source_s), 16)
+
+// Allocates the source with room for its refs (and their unote linkage when
+// they have one) at its tail, and moves the freshly created unote there.
+//
+// For a read source on x86_64 Linux this saves the ~112 byte malloc block of
+// the refs and their linkage, leaving the 128 byte source object, the
+// muxnote shared by all unotes on the fd, and the handler continuation.
+static dispatch_source_t
+_dispatch_source_alloc_with_refs(dispatch_source_refs_t *drp,
+		dispatch_queue_flags_t dqf)
+{
+	dispatch_source_refs_t dr = *drp;
+	size_t refs_size = dux_type(dr)->dst_size, prefix = 0;
+	dispatch_source_t ds;
+	void *src;
+
+	if (!dr->du_is_direct && !dr->du_is_timer) {
+		prefix = sizeof(struct dispatch_unote_linkage_s);
+	}
+	src = (char *)dr - prefix;
+	ds = _dispatch_queue_init(_dispatch_object_alloc(DISPATCH_VTABLE(source),
+			DISPATCH_SOURCE_INLINE_REFS_OFFSET + prefix + refs_size), dqf, 1,
+			DISPATCH_QUEUE_INACTIVE | DISPATCH_QUEUE_ROLE_INNER)._ds;
+
+	// nothing else knows about the unote yet, so it can be moved freely
+	dr = (dispatch_source_refs_t)((char *)ds +
+			DISPATCH_SOURCE_INLINE_REFS_OFFSET + prefix);
+	memcpy((char *)dr - prefix, src, prefix + refs_size);
+	free(src);
+	dr->du_is_inline = true;
+	*drp = dr;
+	return ds;
+}
+#endif // DISPATCH_USE_INLINE_SOURCE_REFS
+
 dispatch_source_t
 dispatch_source_create(dispatch_source_type_t dst, uintptr_t handle,
 		unsigned long mask, dispatch_queue_t dq)
 {
+	dispatch_queue_flags_t dqf;
 	dispatch_source_refs_t dr;
 	dispatch_source_t ds;
 
@@ -50,9 +90,13 @@ dispatch_source_create(dispatch_source_type_t dst, uintptr_t handle,
 		return DISPATCH_BAD_INPUT;
 	}
 
-	ds = _dispatch_queue_alloc(source,
-			dux_type(dr)->dst_strict ? DSF_STRICT : DQF_MUTABLE, 1,
+	dqf = dux_type(dr)->dst_strict ? DSF_STRICT : DQF_MUTABLE;
+#if DISPATCH_USE_INLINE_SOURCE_REFS
+	ds = _dispatch_source_alloc_with_refs(&dr, dqf);
+#else
+	ds = _dispatch_queue_alloc(source, dqf, 1,
 			DISPATCH_QUEUE_INACTIVE | DISPATCH_QUEUE_ROLE_INNER)._ds;
+#endif
 	ds->dq_label = "source";
 	ds->ds_refs = dr;
 	dr->du_owner_wref = _dispatch_ptr2wref(ds);
@@ -79,6 +123,9 @@ _dispatch_source_dispose(dispatch_source_t ds, bool *allow_free)
 	_dispatch_source_handler_free(ds->ds_refs, DS_REGISTN_HANDLER);
 	_dispatch_source_handler_free(ds->ds_refs, DS_EVENT_HANDLER);
 	_dispatch_source_handler_free(ds->ds_refs, DS_CANCEL_HANDLER);
+	if (ds->ds_refs->du_filter == DISPATCH_EVFILT_CUSTOM_VECTOR) {
+		_dispatch_source_vector_dispose(ds->ds_refs);
+	}
 	_dispatch_unote_dispose(ds->ds_refs);
 	ds->ds_refs = NULL;
 	_dispatch_lane_class_dispose(ds, allow_free);
@@ -147,8 +194,8 @@ dispatch_source_get_handle(dispatch_source_t ds)
 unsigned long
 dispatch_source_get_data(dispatch_source_t ds)
 {
-#if DISPATCH_USE_MEMORYSTATUS
 	dispatch_source_refs_t dr = ds->ds_refs;
+#if DISPATCH_USE_MEMORYSTATUS
 	if (dr->du_vmpressure_override) {
 		return NOTE_VM_PRESSURE;
 	}
@@ -159,6 +206,13 @@ dispatch_source_get_data(dispatch_source_t ds)
 #endif
 #endif // DISPATCH_USE_MEMORYSTATUS
 	uint64_t value = os_atomic_load2o(dr, ds_data, relaxed);
+#if DISPATCH_EVENT_BACKEND_EPOLL
+	// once cancelled the client may close the descriptor at any time
+	if (dr->du_data_is_lazy && value &&
+			!(_dispatch_queue_atomic_flags(ds) & DSF_CANCELED)) {
+		return _dispatch_unote_get_lazy_data(dr);
+	}
+#endif
 	return (unsigned long)(dr->du_has_extended_status ?
 			DISPATCH_SOURCE_GET_DATA(value) : value);
 }
@@ -201,6 +255,7 @@ dispatch_source_merge_data(dispatch_source_t ds, unsigned long val)
 {
 	dispatch_queue_flags_t dqf = _dispatch_queue_atomic_flags(ds);
 	dispatch_source_refs_t dr = ds->ds_refs;
+	uint64_t prev;
 
 	if (unlikely(dqf & (DSF_CANCELED | DQF_RELEASED))) {
 		return;
@@ -208,19 +263,364 @@ dispatch_source_merge_data(dispatch_source_t ds, unsigned long val)
 
 	switch (dr->du_filter) {
 	case DISPATCH_EVFILT_CUSTOM_ADD:
-		os_atomic_add2o(dr, ds_pending_data, val, relaxed);
+		prev = os_atomic_add_orig2o(dr, ds_pending_data, val, relaxed);
 		break;
 	case DISPATCH_EVFILT_CUSTOM_OR:
-		os_atomic_or2o(dr, ds_pending_data, val, relaxed);
+		prev = os_atomic_or_orig2o(dr, ds_pending_data, val, relaxed);
 		break;
 	case DISPATCH_EVFILT_CUSTOM_REPLACE:
-		os_atomic_store2o(dr, ds_pending_data, val, relaxed);
+		prev = os_atomic_xchg2o(dr, ds_pending_data, val, relaxed);
 		break;
 	default:
 		DISPATCH_CLIENT_CRASH(dr->du_filter, "Invalid source type");
 	}
 
+	// ds_pending_data is only reset by the exchange that latches it before
+	// the event handler is called. If it wasn't zero, the merge that made it
+	// non zero has issued a wakeup which will be followed by that exchange,
+	// and there is no point hammering the state of the source again.
+	if (likely(prev)) {
+		return;
+	}
+	dx_wakeup(ds, 0, DISPATCH_WAKEUP_MAKE_DIRTY);
+}
+
+#pragma mark -
+#pragma mark dispatch_source_vector
+
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_source_merge_pointer(dispatch_source_t ds, void *ptr)
+{
+	dispatch_queue_flags_t dqf = _dispatch_queue_atomic_flags(ds);
+	dispatch_source_vector_refs_t dsv = (dispatch_source_vector_refs_t)ds->ds_refs;
+	dispatch_continuation_t dc;
+
+	if (unlikely(dsv->du_filter != DISPATCH_EVFILT_CUSTOM_VECTOR)) {
+		DISPATCH_CLIENT_CRASH(dsv->du_filter, "Invalid source type");
+	}
+	if (unlikely(dqf & (DSF_CANCELED | DQF_RELEASED))) {
+		return false;
+	}
+
+	dc = _dispatch_continuation_alloc();
+	dc->dc_ctxt = ptr;
+	os_mpsc_push_item(os_mpsc(dsv, dsv_items), dc, do_next);
+	// see dispatch_source_merge_data()
+	if (likely(os_atomic_inc_orig2o(dsv, ds_pending_data, release))) {
+		return true;
+	}
 	dx_wakeup(ds, 0, DISPATCH_WAKEUP_MAKE_DIRTY);
+	return true;
+}
+
+void
+dispatch_source_merge_pointer(dispatch_source_t ds, void *ptr)
+{
+	(void)_dispatch_source_merge_pointer(ds, ptr);
+}
+
+size_t
+dispatch_source_copy_pointers(dispatch_source_t ds, void **ptrs, size_t count)
+{
+	dispatch_source_vector_refs_t dsv = (dispatch_source_vector_refs_t)ds->ds_refs;
+	dispatch_continuation_t dc, next_dc;
+	size_t n = 0;
+
+	if (unlikely(dsv->du_filter != DISPATCH_EVFILT_CUSTOM_VECTOR)) {
+		DISPATCH_CLIENT_CRASH(dsv->du_filter, "Invalid source type");
+	}
+
+	for (dc = dsv->dsv_batch_head; dc && n < count; dc = next_dc) {
+		next_dc = dc->do_next;
+		ptrs[n++] = dc->dc_ctxt;
+		_dispatch_continuation_free(dc);
+	}
+	dsv->dsv_batch_head = dc;
+	if (!dc) dsv->dsv_batch_tail = NULL;
+	dsv->dsv_batch_count -= n;
+	return n;
+}
+
+// Moves the pointers merged since the last latch to the end of the batch
+// handed to the event handler, and returns the size of that batch.
+static uint64_t
+_dispatch_source_vector_latch(dispatch_source_vector_refs_t dsv)
+{
+	dispatch_continuation_t head, tail, dc;
+	uint64_t count = dsv->dsv_batch_count;
+
+	if (os_mpsc_looks_empty(os_mpsc(dsv, dsv_items))) {
+		return count;
+	}
+	head = os_mpsc_capture_snapshot(os_mpsc(dsv, dsv_items), &tail);
+	for (dc = head; dc; dc = os_mpsc_pop_snapshot_head(dc, tail, do_next)) {
+		count++;
+	}
+	if (dsv->dsv_batch_tail) {
+		dsv->dsv_batch_tail->do_next = head;
+	} else {
+		dsv->dsv_batch_head = head;
+	}
+	dsv->dsv_batch_tail = tail;
+	dsv->dsv_batch_count = count;
+	return count;
+}
+
+static void
+_dispatch_source_vector_dispose(dispatch_source_refs_t dr)
+{
+	dispatch_source_vector_refs_t dsv = (dispatch_source_vector_refs_t)dr;
+	dispatch_continuation_t dc, next_dc;
+
+	// pointers merged but not delivered before cancellation are dropped
+	_dispatch_source_vector_latch(dsv);
+	for (dc = dsv->dsv_batch_head; dc; dc = next_dc) {
+		next_dc = dc->do_next;
+		_dispatch_continuation_free(dc);
+	}
+}
+
+#pragma mark -
+#pragma mark dispatch_source_fd_set
+
+DISPATCH_ALWAYS_INLINE
+static inline int
+_dispatch_source_fd_set_poller(dispatch_source_t ds)
+{
+	dispatch_source_refs_t dr = ds->ds_refs;
+
+	if (unlikely(dr->du_type != DISPATCH_SOURCE_TYPE_FD_SET)) {
+		DISPATCH_CLIENT_CRASH(dr->du_filter, "Invalid source type");
+	}
+	return (int)dr->du_ident;
+}
+
+int
+dispatch_source_fd_set_add(dispatch_source_t ds, dispatch_fd_t fd,
+		dispatch_fd_set_flags_t events)
+{
+	int pfd = _dispatch_source_fd_set_poller(ds);
+
+	if (unlikely(!events ||
+			(events & ~(DISPATCH_FD_SET_READ | DISPATCH_FD_SET_WRITE)))) {
+		return EINVAL;
+	}
+	return _dispatch_fd_set_poller_update(pfd, fd, events);
+}
+
+int
+dispatch_source_fd_set_remove(dispatch_source_t ds, dispatch_fd_t fd)
+{
+	int pfd = _dispatch_source_fd_set_poller(ds);
+	return _dispatch_fd_set_poller_update(pfd, fd, 0);
+}
+
+size_t
+dispatch_source_copy_fd_events(dispatch_source_t ds,
+		dispatch_fd_event_s *events, size_t count)
+{
+	int pfd = _dispatch_source_fd_set_poller(ds);
+	return count ? _dispatch_fd_set_poller_copy(pfd, events, count) : 0;
+}
+
+#pragma mark -
+#pragma mark dispatch_channel_t
+
+static void
+_dispatch_channel_call_block(void *ctxt, void **ptrs, size_t count)
+{
+	dispatch_channel_handler_t handler = ctxt;
+	handler(ptrs, count);
+}
+
+static void
+_dispatch_channel_receive(void *ctxt)
+{
+	dispatch_channel_t dch = ctxt;
+	dispatch_source_t ds = dch->dch_source;
+	size_t count = dispatch_source_get_data(ds);
+	uint32_t old_state;
+
+	// only deliver the batch latched for this invocation so that a source
+	// which is sent to continuously doesn't starve its target queue
+	while (count) {
+		size_t n = dispatch_source_copy_pointers(ds, dch->dch_batch,
+				MIN(count, dch->dch_batch_size));
+		if (unlikely(n == 0)) break;
+		dch->dch_handler(dch->dch_handler_ctxt, dch->dch_batch, n);
+		count -= n;
+
+		old_state = os_atomic_sub_orig2o(dch, dch_state, (uint32_t)n, release);
+		if (unlikely(old_state & DISPATCH_CHANNEL_HAS_WAITERS)) {
+			os_atomic_and2o(dch, dch_state, ~DISPATCH_CHANNEL_HAS_WAITERS,
+					relaxed);
+			_dispatch_wake_by_address(&dch->dch_state);
+		}
+	}
+}
+
+static void
+_dispatch_channel_cancel_handler(void *ctxt)
+{
+	dispatch_channel_t dch = ctxt;
+	_dispatch_release_2(dch); // see _dispatch_channel_create
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_channel_t
+_dispatch_channel_create(dispatch_queue_t dq, size_t capacity,
+		size_t batch_size, void *ctxt, dispatch_channel_handler_function_t func,
+		bool is_block)
+{
+	dispatch_channel_t dch;
+	dispatch_source_t ds;
+
+	if (unlikely(!capacity || capacity > DISPATCH_CHANNEL_COUNT_MASK ||
+			!batch_size)) {
+		return DISPATCH_BAD_INPUT;
+	}
+
+	dch = _dispatch_object_alloc(DISPATCH_VTABLE(channel),
+			sizeof(struct dispatch_channel_s));
+	dch->do_next = DISPATCH_OBJECT_LISTLESS;
+	dch->do_targetq = _dispatch_get_default_queue(false);
+	dch->dch_capacity = (uint32_t)capacity;
+	dch->dch_batch_size = (uint32_t)MIN(batch_size, capacity);
+	dch->dch_batch = _dispatch_calloc(dch->dch_batch_size, sizeof(void *));
+	dch->dch_handler = func;
+	dch->dch_handler_ctxt = ctxt;
+	dch->dch_handler_is_block = is_block;
+
+	ds = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_VECTOR, 0, 0, dq);
+	dispatch_set_context(ds, dch);
+	dispatch_source_set_event_handler_f(ds, _dispatch_channel_receive);
+	dispatch_source_set_cancel_handler_f(ds, _dispatch_channel_cancel_handler);
+	dch->dch_source = ds;
+	// The source holds an internal reference on the channel until its
+	// cancel handler ran, the channel holds one on the source until it is
+	// disposed.
+	_dispatch_retain_2(dch);
+	dispatch_activate(ds);
+	_dispatch_object_debug(dch, "%s", __func__);
+	return dch;
+}
+
+dispatch_channel_t
+dispatch_channel_create_f(dispatch_queue_t dq, size_t capacity,
+		size_t batch_size, void *ctxt, dispatch_channel_handler_function_t func)
+{
+	return _dispatch_channel_create(dq, capacity, batch_size, ctxt, func,
+			false);
+}
+
+#ifdef __BLOCKS__
+dispatch_channel_t
+dispatch_channel_create(dispatch_queue_t dq, size_t capacity,
+		size_t batch_size, dispatch_channel_handler_t handler)
+{
+	dispatch_channel_t dch;
+	void *ctxt = _dispatch_Block_copy(handler);
+
+	dch = _dispatch_channel_create(dq, capacity, batch_size, ctxt,
+			_dispatch_channel_call_block, true);
+	if (unlikely(!dch)) {
+		Block_release(ctxt);
+	}
+	return dch;
+}
+#endif
+
+int
+dispatch_channel_send(dispatch_channel_t dch, void *ptr,
+		dispatch_time_t timeout)
+{
+	uint32_t old_state, new_state;
+
+	for (;;) {
+		os_atomic_rmw_loop2o(dch, dch_state, old_state, new_state, acquire, {
+			if (unlikely(old_state & DISPATCH_CHANNEL_CANCELED)) {
+				os_atomic_rmw_loop_give_up(return ECANCELED);
+			}
+			if ((old_state & DISPATCH_CHANNEL_COUNT_MASK) <
+					dch->dch_capacity) {
+				new_state = old_state + 1;
+			} else if (timeout == DISPATCH_TIME_NOW) {
+				os_atomic_rmw_loop_give_up(return ETIMEDOUT);
+			} else {
+				new_state = old_state | DISPATCH_CHANNEL_HAS_WAITERS;
+				if (old_state == new_state) {
+					os_atomic_rmw_loop_give_up(break);
+				}
+			}
+		});
+		if ((old_state & DISPATCH_CHANNEL_COUNT_MASK) < dch->dch_capacity) {
+			break;
+		}
+		if (_dispatch_wait_on_address(&dch->dch_state, new_state, timeout, 0)
+				== ETIMEDOUT) {
+			return ETIMEDOUT;
+		}
+	}
+
+	if (unlikely(!_dispatch_source_merge_pointer(dch->dch_source, ptr))) {
+		// the channel was cancelled after the slot was reserved, the pointer
+		// was not enqueued and still belongs to the caller
+		os_atomic_dec2o(dch, dch_state, relaxed);
+		return ECANCELED;
+	}
+	return 0;
+}
+
+void
+dispatch_channel_cancel(dispatch_channel_t dch)
+{
+	uint32_t old_state = os_atomic_or_orig2o(dch, dch_state,
+			DISPATCH_CHANNEL_CANCELED, relaxed);
+
+	if (old_state & DISPATCH_CHANNEL_CANCELED) {
+		return;
+	}
+	dispatch_source_cancel(dch->dch_source);
+	if (old_state & DISPATCH_CHANNEL_HAS_WAITERS) {
+		_dispatch_wake_by_address(&dch->dch_state);
+	}
+}
+
+void
+_dispatch_channel_xref_dispose(dispatch_channel_t dch)
+{
+	dispatch_channel_cancel(dch);
+}
+
+void
+_dispatch_channel_dispose(dispatch_channel_t dch,
+		DISPATCH_UNUSED bool *allow_free)
+{
+	dispatch_release(dch->dch_source);
+	if (dch->dch_handler_is_block) {
+		Block_release(dch->dch_handler_ctxt);
+	}
+	free(dch->dch_batch);
+}
+
+size_t
+_dispatch_channel_debug(dispatch_channel_t dch, char *buf, size_t bufsiz)
+{
+	uint32_t dch_state = os_atomic_load2o(dch, dch_state, relaxed);
+
+	size_t offset = 0;
+	offset += dsnprintf(&buf[offset], bufsiz - offset, "%s[%p] = { ",
+			_dispatch_object_class_name(dch), dch);
+	offset += _dispatch_object_debug_attr(dch, &buf[offset], bufsiz - offset);
+	offset += dsnprintf(&buf[offset], bufsiz - offset,
+			"count = %u, capacity = %u, batch = %u, waiters = %d, "
+			"cancelled = %d, source = %p }",
+			dch_state & DISPATCH_CHANNEL_COUNT_MASK, dch->dch_capacity,
+			dch->dch_batch_size,
+			(bool)(dch_state & DISPATCH_CHANNEL_HAS_WAITERS),
+			(bool)(dch_state & DISPATCH_CHANNEL_CANCELED), dch->dch_source);
+	return offset;
 }
 
 #pragma mark -
@@ -531,9 +931,6 @@ _dispatch_source_latch_and_call(dispatch_source_t ds, dispatch_queue_t cq,
 	dispatch_continuation_t dc = _dispatch_source_get_handler(dr, DS_EVENT_HANDLER);
 	uint64_t prev = os_atomic_xchg2o(dr, ds_pending_data, 0, relaxed);
 
-	if (dr->du_is_timer && (dr->du_timer_flags & DISPATCH_TIMER_AFTER)) {
-		_dispatch_trace_item_pop(cq, dc); // see _dispatch_after
-	}
 	switch (dux_type(dr)->dst_action) {
 	case DISPATCH_UNOTE_ACTION_SOURCE_TIMER:
 		if (prev & DISPATCH_TIMER_DISARMED_MARKER) {
@@ -546,6 +943,11 @@ _dispatch_source_latch_and_call(dispatch_source_t ds, dispatch_queue_t cq,
 		dr->ds_data = ~prev;
 		break;
 	default:
+		if (dr->du_filter == DISPATCH_EVFILT_CUSTOM_VECTOR) {
+			prev = _dispatch_source_vector_latch(
+					(dispatch_source_vector_refs_t)dr);
+			if (prev == 0) return;
+		}
 		if (prev == 0 && dr->du_filter == DISPATCH_EVFILT_CUSTOM_REPLACE) {
 			return;
 		}
@@ -576,11 +978,6 @@ _dispatch_source_latch_and_call(dispatch_source_t ds, dispatch_queue_t cq,
 				_dispatch_source_refs_needs_configuration(dr)) {
 			_dispatch_timer_unote_configure(ds->ds_timer_refs);
 		}
-		if (dr->du_timer_flags & DISPATCH_TIMER_AFTER) {
-			_dispatch_trace_item_complete(dc); // see _dispatch_after
-			_dispatch_source_handler_free(dr, DS_EVENT_HANDLER);
-			dispatch_release(ds); // dispatch_after sources are one-shot
-		}
 	}
 }
 
@@ -621,6 +1018,32 @@ _dispatch_source_refs_unregister(dispatch_source_t ds, uint32_t options)
 	});
 }
 
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+// Timers directly targeting a workloop live in the timer heap of that workloop
+// and are configured, armed and disarmed while it is drained, instead of on
+// the manager queue.
+DISPATCH_ALWAYS_INLINE
+static inline dispatch_workloop_t
+_dispatch_source_timer_workloop(dispatch_source_refs_t dr)
+{
+	dispatch_wlh_t wlh = _dispatch_unote_wlh(dr);
+	if (dr->du_is_timer && wlh && wlh != DISPATCH_WLH_ANON) {
+		return (dispatch_workloop_t)wlh;
+	}
+	return NULL;
+}
+
+static void
+_dispatch_source_timer_set_workloop(dispatch_source_t ds)
+{
+	dispatch_workloop_t dwl = upcast(ds->do_targetq)._dwl;
+
+	(void)_dispatch_event_loop_workloop_timer_heap(dwl);
+	_dispatch_wlh_retain((dispatch_wlh_t)dwl);
+	_dispatch_unote_state_set(ds->ds_refs, (dispatch_wlh_t)dwl, 0);
+}
+#endif // DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+
 static void
 _dispatch_source_install(dispatch_source_t ds, dispatch_wlh_t wlh,
 		dispatch_priority_t pri)
@@ -671,6 +1094,13 @@ _dispatch_source_activate(dispatch_source_t ds, bool *allow_resume)
 
 	if ((dr->du_is_direct || dr->du_is_timer) && !ds->ds_is_installed) {
 		pri = _dispatch_queue_compute_priority_and_wlh(ds, &wlh);
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+		if (dr->du_is_timer &&
+				dx_metatype(ds->do_targetq) == _DISPATCH_WORKLOOP_TYPE) {
+			_dispatch_source_timer_set_workloop(ds);
+			wlh = _dispatch_unote_wlh(dr);
+		}
+#endif
 		if (pri) {
 			_dispatch_source_install(ds, wlh, pri);
 		}
@@ -702,10 +1132,15 @@ _dispatch_source_invoke2(dispatch_source_t ds, dispatch_invoke_context_t dic,
 	dispatch_queue_wakeup_target_t retq = DISPATCH_QUEUE_WAKEUP_NONE;
 	dispatch_queue_t dq = _dispatch_queue_get_current();
 	dispatch_source_refs_t dr = ds->ds_refs;
+	dispatch_wlh_t event_wlh = _dispatch_get_event_wlh();
 	dispatch_queue_flags_t dqf;
 
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+	dispatch_workloop_t dwl = _dispatch_source_timer_workloop(dr);
+	if (dwl) event_wlh = (dispatch_wlh_t)dwl;
+#endif
 	if (unlikely(!(flags & DISPATCH_INVOKE_MANAGER_DRAIN) &&
-			_dispatch_unote_wlh_changed(dr, _dispatch_get_event_wlh()))) {
+			_dispatch_unote_wlh_changed(dr, event_wlh))) {
 		_dispatch_source_handle_wlh_change(ds);
 	}
 
@@ -731,6 +1166,11 @@ _dispatch_source_invoke2(dispatch_source_t ds, dispatch_invoke_context_t dic,
 	if (dr->du_is_direct) {
 		dkq = ds->do_targetq;
 	}
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+	if (dwl) {
+		dkq = dwl->_as_dq;
+	}
+#endif
 
 	if (!ds->ds_is_installed) {
 		// The source needs to be installed on the kevent queue.
@@ -741,7 +1181,7 @@ _dispatch_source_invoke2(dispatch_source_t ds, dispatch_invoke_context_t dic,
 		if (likely(flags & DISPATCH_INVOKE_WORKER_DRAIN)) {
 			pri = _dispatch_get_basepri();
 		}
-		_dispatch_source_install(ds, _dispatch_get_event_wlh(), pri);
+		_dispatch_source_install(ds, event_wlh, pri);
 	}
 
 	if (unlikely(DISPATCH_QUEUE_IS_SUSPENDED(ds))) {
@@ -887,6 +1327,17 @@ _dispatch_source_invoke(dispatch_source_t ds, dispatch_invoke_context_t dic,
 					DISPATCH_TIMER_WLH_COUNT);
 		}
 	}
+#elif DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+	// program the timerfds of the workloop after the source (re)armed its
+	// timer, see _dispatch_source_timer_workloop()
+	dispatch_queue_t dq = _dispatch_queue_get_current();
+	if ((flags & DISPATCH_INVOKE_WORKLOOP_DRAIN) &&
+			dx_metatype(dq) == _DISPATCH_WORKLOOP_TYPE) {
+		dispatch_timer_heap_t dth = upcast(dq)._dwl->dwl_timer_heap;
+		if (dth && dth[0].dth_dirty_bits) {
+			_dispatch_event_loop_drain_timers(dth, DISPATCH_TIMER_WLH_COUNT);
+		}
+	}
 #endif // DISPATCH_EVENT_BACKEND_KEVENT
 }
 
@@ -906,6 +1357,12 @@ _dispatch_source_wakeup(dispatch_source_t ds, dispatch_qos_t qos,
 	if (dr->du_is_direct) {
 		dkq = DISPATCH_QUEUE_WAKEUP_TARGET;
 	}
+#if DISPATCH_USE_WORKLOOP_TIMER_HEAPS
+	dispatch_workloop_t dwl = _dispatch_source_timer_workloop(dr);
+	if (dwl) {
+		dkq = dwl->_as_dq;
+	}
+#endif
 
 	if (!ds->ds_is_installed) {
 		// The source needs to be installed on the kevent queue.
@@ -1303,8 +1760,8 @@ static inline void
 _dispatch_after(dispatch_time_t when, dispatch_queue_t dq,
 		void *ctxt, void *handler, bool block)
 {
+	dispatch_after_refs_t dar;
 	dispatch_timer_source_refs_t dt;
-	dispatch_source_t ds;
 	uint64_t leeway, delta;
 
 	if (when == DISPATCH_TIME_FOREVER) {
@@ -1326,20 +1783,23 @@ _dispatch_after(dispatch_time_t when, dispatch_queue_t dq,
 	if (leeway < NSEC_PER_MSEC) leeway = NSEC_PER_MSEC;
 	if (leeway > 60 * NSEC_PER_SEC) leeway = 60 * NSEC_PER_SEC;
 
-	// this function can and should be optimized to not use a dispatch source
-	ds = dispatch_source_create(&_dispatch_source_type_after, 0, 0, dq);
-	dt = ds->ds_timer_refs;
-
 	dispatch_continuation_t dc = _dispatch_continuation_alloc();
 	if (block) {
-		_dispatch_continuation_init(dc, dq, handler, 0, 0);
+		_dispatch_continuation_init(dc, dq, handler, 0, DC_FLAG_CONSUME);
 	} else {
-		_dispatch_continuation_init_f(dc, dq, ctxt, handler, 0, 0);
+		_dispatch_continuation_init_f(dc, dq, ctxt, handler, 0,
+				DC_FLAG_CONSUME);
 	}
-	// reference `ds` so that it doesn't show up as a leak
-	dc->dc_data = ds;
-	_dispatch_trace_item_push(dq, dc);
-	os_atomic_store2o(dt, ds_handler[DS_EVENT_HANDLER], dc, relaxed);
+
+	// There is no source involved: the timer is a bare heap entry that the
+	// manager arms, and that pushes `dc` onto `dq` when it fires.
+	dar = _dispatch_calloc(1u, sizeof(struct dispatch_after_refs_s));
+	dt = &dar->dar_timer;
+	dt->du_owner_wref = _dispatch_ptr2wref(NULL);
+	dt->du_filter = DISPATCH_EVFILT_TIMER_WITH_CLOCK;
+	dt->du_is_timer = true;
+	dt->du_priority = dq->dq_priority;
+	dt->ds_handler[DS_EVENT_HANDLER] = dc;
 
 	dispatch_clock_t clock;
 	uint64_t target;
@@ -1347,11 +1807,22 @@ _dispatch_after(dispatch_time_t when, dispatch_queue_t dq,
 	if (clock != DISPATCH_CLOCK_WALL) {
 		leeway = _dispatch_time_nano2mach(leeway);
 	}
-	dt->du_timer_flags |= _dispatch_timer_flags_from_clock(clock);
+	dt->du_timer_flags = DISPATCH_TIMER_AFTER |
+			_dispatch_timer_flags_from_clock(clock);
+	// aggressively coalesce background/maintenance QoS timers
+	// see _dispatch_timer_unote_register()
+	if (_dispatch_qos_is_background(_dispatch_priority_qos(dt->du_priority))) {
+		dt->du_timer_flags |= DISPATCH_TIMER_BACKGROUND;
+	}
 	dt->dt_timer.target = target;
 	dt->dt_timer.interval = UINT64_MAX;
 	dt->dt_timer.deadline = target + leeway;
-	dispatch_activate(ds);
+	dt->dt_heap_entry[DTH_TARGET_ID] = DTH_INVALID_ID;
+	dt->dt_heap_entry[DTH_DEADLINE_ID] = DTH_INVALID_ID;
+
+	dar->dar_queue = dq;
+	_dispatch_retain_2(dq); // released in _dispatch_after_timer_fire
+	_dispatch_after_timer_enqueue(dar);
 }
 
 DISPATCH_NOINLINE
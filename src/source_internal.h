@@ -68,4 +68,42 @@ void _dispatch_source_merge_evt(dispatch_unote_t du, uint32_t flags,
 		uintptr_t data, pthread_priority_t pp);
 size_t _dispatch_source_debug(dispatch_source_t ds, char* buf, size_t bufsiz);
 
+/*
+ * Dispatch Channel State:
+ *
+ * Has Waiters (31):
+ *   This bit is set when producers wait in dispatch_channel_send() for the
+ *   channel to have room again. The consumer clears it and wakes them up
+ *   after it received pointers.
+ *
+ * Cancelled (30):
+ *   This bit is set when the channel is cancelled.
+ *
+ * Count (0 - 29):
+ *   The number of pointers that were sent and not received yet. Producers
+ *   reserve their slot in this count before they merge their pointer into
+ *   the DATA_VECTOR source of the channel.
+ */
+#define DISPATCH_CHANNEL_HAS_WAITERS    0x80000000u
+#define DISPATCH_CHANNEL_CANCELED       0x40000000u
+#define DISPATCH_CHANNEL_COUNT_MASK     0x3fffffffu
+
+DISPATCH_CLASS_DECL(channel, OBJECT);
+struct dispatch_channel_s {
+	DISPATCH_OBJECT_HEADER(channel);
+	uint32_t volatile dch_state;
+	uint32_t dch_capacity;
+	uint32_t dch_batch_size;
+	bool dch_handler_is_block;
+	dispatch_source_t dch_source;
+	dispatch_channel_handler_function_t dch_handler;
+	void *dch_handler_ctxt;
+	void **dch_batch; // only used by the event handler of dch_source
+};
+
+void _dispatch_channel_xref_dispose(dispatch_channel_t dch);
+void _dispatch_channel_dispose(dispatch_channel_t dch, bool *allow_free);
+size_t _dispatch_channel_debug(dispatch_channel_t dch, char* buf,
+		size_t bufsiz);
+
 #endif /* __DISPATCH_SOURCE_INTERNAL__ */
@@ -29,7 +29,7 @@
 
 #if DISPATCH_PURE_C
 
-#if DISPATCH_USE_DTRACE_INTROSPECTION
+#if DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_USE_SDT
 #define _dispatch_trace_callout(_c, _f, _dcc) do { \
 		if (unlikely(DISPATCH_CALLOUT_ENTRY_ENABLED() || \
 				DISPATCH_CALLOUT_RETURN_ENABLED())) { \
@@ -44,12 +44,25 @@
 			_dcc; \
 		} \
 	} while (0)
-#elif DISPATCH_INTROSPECTION
+#elif DISPATCH_INTROSPECTION || DISPATCH_USE_TRACE_BUFFER
 #define _dispatch_trace_callout(_c, _f, _dcc) \
 		do { (void)(_c); (void)(_f); _dcc; } while (0)
-#endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION
+#endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_USE_SDT || ...
+
+#if DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION || \
+		DISPATCH_USE_SDT || DISPATCH_USE_TRACE_BUFFER
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_buffer_callout(dispatch_trace_event_t event, void *ctxt,
+		dispatch_function_t func)
+{
+	if (unlikely(_dispatch_trace_buffer_recording())) {
+		dispatch_queue_t dq = _dispatch_queue_get_current();
+		_dispatch_trace_buffer_record(event, dq ? dq->dq_serialnum : 0,
+				ctxt, func);
+	}
+}
 
-#if DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION
 DISPATCH_ALWAYS_INLINE
 static inline void
 _dispatch_trace_client_callout(void *ctxt, dispatch_function_t f)
@@ -57,7 +70,11 @@ _dispatch_trace_client_callout(void *ctxt, dispatch_function_t f)
 	dispatch_function_t func = (f == _dispatch_call_block_and_release &&
 			ctxt ? _dispatch_Block_invoke(ctxt) : f);
 	_dispatch_introspection_callout_entry(ctxt, func);
+	_dispatch_trace_buffer_callout(DISPATCH_TRACE_EVENT_CALLOUT_ENTRY,
+			ctxt, func);
 	_dispatch_trace_callout(ctxt, func, _dispatch_client_callout(ctxt, f));
+	_dispatch_trace_buffer_callout(DISPATCH_TRACE_EVENT_CALLOUT_RETURN,
+			ctxt, func);
 	_dispatch_introspection_callout_return(ctxt, func);
 }
 
@@ -67,13 +84,17 @@ _dispatch_trace_client_callout2(void *ctxt, size_t i, void (*f)(void *, size_t))
 {
 	dispatch_function_t func = (dispatch_function_t)f;
 	_dispatch_introspection_callout_entry(ctxt, func);
+	_dispatch_trace_buffer_callout(DISPATCH_TRACE_EVENT_CALLOUT_ENTRY,
+			ctxt, func);
 	_dispatch_trace_callout(ctxt, func, _dispatch_client_callout2(ctxt, i, f));
+	_dispatch_trace_buffer_callout(DISPATCH_TRACE_EVENT_CALLOUT_RETURN,
+			ctxt, func);
 	_dispatch_introspection_callout_return(ctxt, func);
 }
 
 #define _dispatch_client_callout		_dispatch_trace_client_callout
 #define _dispatch_client_callout2		_dispatch_trace_client_callout2
-#endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION
+#endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION || ...
 
 #ifdef _COMM_PAGE_KDEBUG_ENABLE
 #define DISPATCH_KTRACE_ENABLED \
@@ -93,7 +114,7 @@ _dispatch_trace_client_callout2(void *ctxt, size_t i, void (*f)(void *, size_t))
 #endif /* _COMM_PAGE_KDEBUG_ENABLE */
 
 
-#if DISPATCH_USE_DTRACE_INTROSPECTION
+#if DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_USE_SDT
 #define _dispatch_trace_continuation(_q, _o, _t) do { \
 		dispatch_queue_t _dq = (_q); \
 		const char *_label = _dq && _dq->dq_label ? _dq->dq_label : ""; \
@@ -131,14 +152,18 @@ _dispatch_trace_client_callout2(void *ctxt, size_t i, void (*f)(void *, size_t))
 		} \
 		_t(_dq, _label, _do, _kind, _func, _ctxt); \
 	} while (0)
-#elif DISPATCH_INTROSPECTION
+#elif DISPATCH_INTROSPECTION || DISPATCH_USE_TRACE_BUFFER
 #define _dispatch_trace_continuation(_q, _o, _t) \
 		do { (void)(_q); (void)(_o); } while(0)
 #define DISPATCH_QUEUE_PUSH_ENABLED() 0
 #define DISPATCH_QUEUE_POP_ENABLED() 0
-#endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION
+#define DISPATCH_RUNTIME_EVENT_ENABLED() 0
+#define DISPATCH_RUNTIME_EVENT(event, ptr, value) \
+		do { (void)(event); (void)(ptr); (void)(value); } while(0)
+#endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_USE_SDT || ...
 
-#if DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION
+#if DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION || \
+		DISPATCH_USE_SDT || DISPATCH_USE_TRACE_BUFFER
 
 DISPATCH_ALWAYS_INLINE
 static inline dispatch_queue_class_t
@@ -238,6 +263,22 @@ _dispatch_trace_firehose_chunk_install(uint64_t ask0, uint64_t ask1,
 			old_state, new_state);
 }
 
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_buffer_item(dispatch_trace_event_t event, dispatch_queue_t dq,
+		struct dispatch_object_s *dou)
+{
+	if (unlikely(_dispatch_trace_buffer_recording())) {
+		dispatch_function_t func = NULL;
+		if (!_dispatch_object_has_vtable(dou)) {
+			dispatch_continuation_t dc = (dispatch_continuation_t)dou;
+			func = (dc->dc_flags & DC_FLAG_BLOCK) ?
+					_dispatch_Block_invoke(dc->dc_ctxt) : dc->dc_func;
+		}
+		_dispatch_trace_buffer_record(event, dq->dq_serialnum, dou, func);
+	}
+}
+
 /* Implemented in introspection.c */
 void
 _dispatch_trace_item_push_internal(dispatch_queue_t dq, dispatch_object_t dou);
@@ -252,12 +293,15 @@ static inline void
 _dispatch_trace_item_push_list(dispatch_queue_global_t dq,
 		dispatch_object_t _head, dispatch_object_t _tail)
 {
-	if (unlikely(DISPATCH_QUEUE_PUSH_ENABLED() || DISPATCH_KTRACE_ENABLED)) {
+	if (unlikely(DISPATCH_QUEUE_PUSH_ENABLED() || DISPATCH_KTRACE_ENABLED ||
+			_dispatch_trace_buffer_recording())) {
 		struct dispatch_object_s *dou = _head._do;
 		do {
 			if (unlikely(DISPATCH_QUEUE_PUSH_ENABLED())) {
 				_dispatch_trace_continuation(dq->_as_dq, dou, DISPATCH_QUEUE_PUSH);
 			}
+			_dispatch_trace_buffer_item(DISPATCH_TRACE_EVENT_PUSH,
+					dq->_as_dq, dou);
 
 			_dispatch_trace_item_push_inline(dq->_as_dq, dou);
 		} while (dou != _tail._do && (dou = dou->do_next));
@@ -272,7 +316,7 @@ _dispatch_trace_item_push(dispatch_queue_class_t dqu, dispatch_object_t _tail)
 	if (unlikely(DISPATCH_QUEUE_PUSH_ENABLED())) {
 		_dispatch_trace_continuation(dqu._dq, _tail._do, DISPATCH_QUEUE_PUSH);
 	}
-
+	_dispatch_trace_buffer_item(DISPATCH_TRACE_EVENT_PUSH, dqu._dq, _tail._do);
 	_dispatch_trace_item_push_inline(dqu._dq, _tail._do);
 	_dispatch_introspection_queue_push(dqu, _tail);
 }
@@ -293,7 +337,7 @@ _dispatch_trace_item_pop(dispatch_queue_class_t dqu, dispatch_object_t dou)
 	if (unlikely(DISPATCH_QUEUE_POP_ENABLED())) {
 		_dispatch_trace_continuation(dqu._dq, dou._do, DISPATCH_QUEUE_POP);
 	}
-
+	_dispatch_trace_buffer_item(DISPATCH_TRACE_EVENT_POP, dqu._dq, dou._do);
 	_dispatch_trace_item_pop_inline(dqu._dq, dou);
 	_dispatch_introspection_queue_pop(dqu, dou);
 }
@@ -334,9 +378,17 @@ _dispatch_trace_source_callout_entry_internal(dispatch_source_t ds, long kind,
 			_dispatch_trace_source_callout_entry_internal(__VA_ARGS__); \
 		})
 
-#define _dispatch_trace_runtime_event(evt, ptr, value) \
+#define _dispatch_trace_runtime_event(evt, ptr, value) do { \
+		if (unlikely(DISPATCH_RUNTIME_EVENT_ENABLED())) { \
+			DISPATCH_RUNTIME_EVENT(dispatch_introspection_runtime_event_##evt, \
+					(void *)(ptr), (unsigned long long)(value)); \
+		} \
+		_dispatch_trace_buffer_record(DISPATCH_TRACE_EVENT_RUNTIME, \
+				dispatch_introspection_runtime_event_##evt, \
+				(void *)(ptr), (void *)(uintptr_t)(value)); \
 		_dispatch_introspection_runtime_event(\
-				dispatch_introspection_runtime_event_##evt, ptr, value)
+				dispatch_introspection_runtime_event_##evt, ptr, value); \
+	} while (0)
 
 #define DISPATCH_TRACE_ARG(arg) , arg
 #else
@@ -379,9 +431,9 @@ _dispatch_trace_source_callout_entry_internal(dispatch_source_t ds, long kind,
 #define _dispatch_trace_runtime_event(evt, ptr, value) \
 		do { (void)(ptr); (void)(value); } while(0)
 #define DISPATCH_TRACE_ARG(arg)
-#endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION
+#endif // DISPATCH_USE_DTRACE_INTROSPECTION || DISPATCH_INTROSPECTION || ...
 
-#if DISPATCH_USE_DTRACE
+#if DISPATCH_USE_DTRACE || DISPATCH_USE_SDT
 static inline dispatch_function_t
 _dispatch_trace_timer_function(dispatch_timer_source_refs_t dr)
 {
@@ -457,7 +509,8 @@ static inline void
 _dispatch_trace_timer_program(dispatch_timer_source_refs_t dr, uint64_t deadline)
 {
 	if (unlikely(DISPATCH_TIMER_PROGRAM_ENABLED())) {
-		if (deadline && dr) {
+		// dispatch_after() timers have no source to report
+		if (deadline && dr && !(dr->du_timer_flags & DISPATCH_TIMER_AFTER)) {
 			dispatch_source_t ds = _dispatch_source_from_refs(dr);
 			dispatch_clock_t clock = DISPATCH_TIMER_CLOCK(dr->du_ident);
 			struct dispatch_trace_timer_params_s params;
@@ -473,7 +526,7 @@ static inline void
 _dispatch_trace_timer_wake(dispatch_timer_source_refs_t dr)
 {
 	if (unlikely(DISPATCH_TIMER_WAKE_ENABLED())) {
-		if (dr) {
+		if (dr && !(dr->du_timer_flags & DISPATCH_TIMER_AFTER)) {
 			dispatch_source_t ds = _dispatch_source_from_refs(dr);
 			DISPATCH_TIMER_WAKE(ds, _dispatch_trace_timer_function(dr));
 		}
@@ -493,6 +546,15 @@ _dispatch_trace_timer_fire(dispatch_timer_source_refs_t dr, uint64_t data,
 	}
 }
 
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_after_fire(dispatch_queue_t dq, dispatch_continuation_t dc)
+{
+	if (unlikely(DISPATCH_AFTER_FIRE_ENABLED())) {
+		DISPATCH_AFTER_FIRE(dq, dc->dc_func, dc->dc_ctxt);
+	}
+}
+
 #else
 
 #define _dispatch_trace_timer_configure_enabled() false
@@ -504,8 +566,10 @@ _dispatch_trace_timer_fire(dispatch_timer_source_refs_t dr, uint64_t data,
 		do { (void)(dr); } while(0)
 #define _dispatch_trace_timer_fire(dr, data, missed) \
 		do { (void)(dr); (void)(data); (void)(missed); } while(0)
+#define _dispatch_trace_after_fire(dq, dc) \
+		do { (void)(dq); (void)(dc); } while(0)
 
-#endif // DISPATCH_USE_DTRACE
+#endif // DISPATCH_USE_DTRACE || DISPATCH_USE_SDT
 
 #endif // DISPATCH_PURE_C
 
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2019 Apple Inc. All rights reserved.
+ *
+ * @APPLE_APACHE_LICENSE_HEADER_START@
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @APPLE_APACHE_LICENSE_HEADER_END@
+ */
+
+#include "internal.h"
+
+#if DISPATCH_USE_TRACE_BUFFER
+bool _dispatch_trace_buffer_enabled;
+__thread dispatch_trace_buffer_t __dispatch_trace_buffer;
+// set once the buffer of the thread was given back at thread exit, events
+// recorded by later thread specific destructors are dropped
+static __thread bool __dispatch_trace_buffer_exited;
+
+// Buffers are never freed: the list only grows by prepending to its head,
+// so that it can be walked without a lock, including from a signal handler.
+static dispatch_trace_buffer_t volatile _dispatch_trace_buffers;
+static char _dispatch_trace_buffer_path[PATH_MAX];
+
+#pragma mark -
+#pragma mark dispatch_trace_buffer_t
+
+static void
+_dispatch_trace_chunk_reset(dispatch_trace_chunk_t dtc, uint64_t now)
+{
+	uint64_t gen = dtc->dtc_generation;
+
+	os_atomic_store2o(dtc, dtc_generation, gen + 1, relaxed);
+	os_atomic_thread_fence(release);
+	dtc->dtc_timestamp = now;
+	dtc->dtc_count = 0;
+	os_atomic_store2o(dtc, dtc_generation, gen + 2, release);
+}
+
+dispatch_trace_chunk_t
+_dispatch_trace_buffer_next_chunk(dispatch_trace_buffer_t dtb, uint64_t now)
+{
+	dispatch_trace_chunk_t dtc;
+
+	dtc = &dtb->dtb_chunks[++dtb->dtb_head % DISPATCH_TRACE_CHUNK_COUNT];
+	_dispatch_trace_chunk_reset(dtc, now);
+	return dtc;
+}
+
+DISPATCH_NOINLINE
+dispatch_trace_buffer_t
+_dispatch_trace_buffer_register(void)
+{
+	uint64_t tid, now;
+	dispatch_trace_buffer_t dtb, head;
+
+	if (unlikely(__dispatch_trace_buffer_exited)) {
+		return NULL;
+	}
+	tid = (uint64_t)_dispatch_tid_self();
+	now = _dispatch_time_mach2nano(_dispatch_uptime());
+	// adopt the buffer of a thread that exited if there is one
+	head = os_atomic_load(&_dispatch_trace_buffers, acquire);
+	for (dtb = head; dtb; dtb = dtb->dtb_next) {
+		if (os_atomic_cmpxchg2o(dtb, dtb_owner, 0, tid, acquire)) {
+			dtb->dtb_tid = tid;
+			for (uint32_t i = 1; i < DISPATCH_TRACE_CHUNK_COUNT; i++) {
+				_dispatch_trace_chunk_reset(&dtb->dtb_chunks[
+						(dtb->dtb_head + i) % DISPATCH_TRACE_CHUNK_COUNT], 0);
+			}
+			_dispatch_trace_buffer_next_chunk(dtb, now);
+			goto out;
+		}
+	}
+
+	dtb = _dispatch_calloc(1, sizeof(struct dispatch_trace_buffer_s));
+	dtb->dtb_owner = tid;
+	dtb->dtb_tid = tid;
+	_dispatch_trace_chunk_reset(&dtb->dtb_chunks[0], now);
+	os_atomic_rmw_loop(&_dispatch_trace_buffers, head, dtb, release, {
+		dtb->dtb_next = head;
+	});
+out:
+	__dispatch_trace_buffer = dtb;
+	return dtb;
+}
+
+void
+_dispatch_trace_buffer_unregister(void)
+{
+	dispatch_trace_buffer_t dtb = __dispatch_trace_buffer;
+
+	__dispatch_trace_buffer_exited = true;
+	if (!dtb) return;
+	__dispatch_trace_buffer = NULL;
+	// the content is kept until another thread adopts the buffer
+	os_atomic_store2o(dtb, dtb_owner, 0, release);
+}
+
+#pragma mark -
+#pragma mark dump
+
+static int
+_dispatch_trace_buffer_write(int fd, const void *buf, size_t size)
+{
+	const char *ptr = buf;
+
+	while (size) {
+		ssize_t n = write(fd, ptr, size);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return errno;
+		}
+		ptr += n;
+		size -= (size_t)n;
+	}
+	return 0;
+}
+
+// Copies a chunk that its owner may be writing to concurrently.
+// A chunk that got recycled while being copied is reported empty.
+static void
+_dispatch_trace_chunk_copy(dispatch_trace_chunk_t dst,
+		dispatch_trace_chunk_t src)
+{
+	uint64_t gen = os_atomic_load2o(src, dtc_generation, acquire);
+	uint32_t count = os_atomic_load2o(src, dtc_count, acquire);
+
+	memset(dst, 0, DISPATCH_TRACE_CHUNK_SIZE);
+	if (gen == 0 || (gen & 1)) return;
+	dst->dtc_generation = gen;
+	dst->dtc_timestamp = src->dtc_timestamp;
+	memcpy(dst->dtc_entries, src->dtc_entries,
+			count * sizeof(struct dispatch_trace_entry_s));
+	os_atomic_thread_fence(acquire);
+	if (os_atomic_load2o(src, dtc_generation, relaxed) == gen) {
+		dst->dtc_count = count;
+	} else {
+		dst->dtc_generation = 0;
+	}
+}
+
+static int
+_dispatch_trace_buffer_dump(int fd)
+{
+	union {
+		struct dispatch_trace_chunk_s dtc;
+		char buf[DISPATCH_TRACE_CHUNK_SIZE];
+	} chunk;
+	struct dispatch_trace_dump_header_s dtdh = {
+		.dtdh_magic = DISPATCH_TRACE_DUMP_MAGIC,
+		.dtdh_version = DISPATCH_TRACE_DUMP_VERSION,
+		.dtdh_chunk_size = DISPATCH_TRACE_CHUNK_SIZE,
+		.dtdh_entry_size = sizeof(struct dispatch_trace_entry_s),
+		.dtdh_timestamp = _dispatch_time_mach2nano(_dispatch_uptime()),
+	};
+	dispatch_trace_buffer_t head, dtb;
+	int err;
+
+	// threads registering concurrently are not part of this dump
+	head = os_atomic_load(&_dispatch_trace_buffers, acquire);
+	for (dtb = head; dtb; dtb = dtb->dtb_next) {
+		dtdh.dtdh_thread_count++;
+	}
+	err = _dispatch_trace_buffer_write(fd, &dtdh, sizeof(dtdh));
+	if (err) return err;
+
+	for (dtb = head; dtb; dtb = dtb->dtb_next) {
+		struct dispatch_trace_dump_thread_s dtdt = {
+			.dtdt_tid = dtb->dtb_tid,
+			.dtdt_chunk_count = DISPATCH_TRACE_CHUNK_COUNT,
+		};
+		uint32_t first = dtb->dtb_head + 1;
+
+		err = _dispatch_trace_buffer_write(fd, &dtdt, sizeof(dtdt));
+		if (err) return err;
+		for (uint32_t i = 0; i < DISPATCH_TRACE_CHUNK_COUNT; i++) {
+			_dispatch_trace_chunk_copy(&chunk.dtc, &dtb->dtb_chunks[
+					(first + i) % DISPATCH_TRACE_CHUNK_COUNT]);
+			err = _dispatch_trace_buffer_write(fd, chunk.buf, sizeof(chunk));
+			if (err) return err;
+		}
+	}
+	return 0;
+}
+
+static void
+_dispatch_trace_buffer_signal_handler(int signo DISPATCH_UNUSED)
+{
+	int saved_errno = errno;
+	int fd;
+
+	fd = open(_dispatch_trace_buffer_path,
+			O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd >= 0) {
+		(void)_dispatch_trace_buffer_dump(fd);
+		(void)close(fd);
+	}
+	errno = saved_errno;
+}
+
+void
+_dispatch_trace_buffer_init(void)
+{
+	const char *str;
+	int signo;
+
+	if (!_dispatch_getenv_bool("LIBDISPATCH_TRACE_BUFFER", false)) {
+		return;
+	}
+	_dispatch_trace_buffer_enabled = true;
+
+	str = getenv("LIBDISPATCH_TRACE_BUFFER_SIGNAL");
+	if (!str) return;
+	signo = atoi(str);
+	if (signo <= 0 || signo >= NSIG) {
+		_dispatch_log("LIBDISPATCH_TRACE_BUFFER_SIGNAL: invalid signal %s",
+				str);
+		return;
+	}
+
+	str = getenv("LIBDISPATCH_TRACE_BUFFER_PATH");
+	if (str) {
+		strlcpy(_dispatch_trace_buffer_path, str,
+				sizeof(_dispatch_trace_buffer_path));
+	} else {
+		snprintf(_dispatch_trace_buffer_path,
+				sizeof(_dispatch_trace_buffer_path),
+				"/tmp/libdispatch.%d.trace", getpid());
+	}
+
+	struct sigaction sa = {
+		.sa_handler = _dispatch_trace_buffer_signal_handler,
+		.sa_flags = SA_RESTART,
+	};
+	sigemptyset(&sa.sa_mask);
+	(void)dispatch_assume_zero(sigaction(signo, &sa, NULL));
+}
+#endif // DISPATCH_USE_TRACE_BUFFER
+
+int
+dispatch_introspection_trace_buffer_dump(int fd)
+{
+#if DISPATCH_USE_TRACE_BUFFER
+	if (!_dispatch_trace_buffer_enabled) return ENOTSUP;
+	return _dispatch_trace_buffer_dump(fd);
+#else
+	(void)fd;
+	return ENOTSUP;
+#endif
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2019 Apple Inc. All rights reserved.
+ *
+ * @APPLE_APACHE_LICENSE_HEADER_START@
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @APPLE_APACHE_LICENSE_HEADER_END@
+ */
+
+/*
+ * IMPORTANT: This header file describes INTERNAL interfaces to libdispatch
+ * which are subject to change in future releases of Mac OS X. Any applications
+ * relying on these interfaces WILL break.
+ */
+
+#ifndef __DISPATCH_TRACE_BUFFER_INTERNAL__
+#define __DISPATCH_TRACE_BUFFER_INTERNAL__
+
+/*
+ * Flight recorder
+ *
+ * When LIBDISPATCH_TRACE_BUFFER is set in the environment, every thread
+ * records queue pushes and pops, client callouts and runtime events into a
+ * small per-thread ring of fixed-size chunks. Recording is done by the owner
+ * thread only and takes no lock: the rings can be dumped at any time from any
+ * thread or from a signal handler with dispatch_introspection_trace_buffer_dump()
+ * and tools/dispatch_trace_convert.py turns such a dump into a Chrome trace
+ * (also readable by Perfetto).
+ *
+ * The chunk layout is modeled on firehose chunks: a chunk carries a base
+ * timestamp and entries only store a 48-bit nanosecond delta from it. The
+ * generation of a chunk is odd while its owner recycles it, so that readers
+ * can discard chunks that changed under them.
+ *
+ * The dump format is:
+ * - a struct dispatch_trace_dump_header_s,
+ * - for each thread buffer, a struct dispatch_trace_dump_thread_s followed by
+ *   dtdt_chunk_count chunks of DISPATCH_TRACE_CHUNK_SIZE bytes, oldest first.
+ */
+
+#ifndef DISPATCH_USE_TRACE_BUFFER
+#if DISPATCH_USE_THREAD_LOCAL_STORAGE
+#define DISPATCH_USE_TRACE_BUFFER 1
+#else
+#define DISPATCH_USE_TRACE_BUFFER 0
+#endif
+#endif // !defined(DISPATCH_USE_TRACE_BUFFER)
+
+#define DISPATCH_TRACE_DUMP_MAGIC	0x4853415053494444ull // "DDISPASH"
+#define DISPATCH_TRACE_DUMP_VERSION	1
+
+#define DISPATCH_TRACE_CHUNK_SIZE	4096u
+#define DISPATCH_TRACE_CHUNK_COUNT	4u
+#define DISPATCH_TRACE_STAMP_DELTA_MAX	((1ull << 48) - 1)
+
+DISPATCH_ENUM(dispatch_trace_event, uint16_t,
+	DISPATCH_TRACE_EVENT_PUSH = 1,
+	DISPATCH_TRACE_EVENT_POP,
+	DISPATCH_TRACE_EVENT_CALLOUT_ENTRY,
+	DISPATCH_TRACE_EVENT_CALLOUT_RETURN,
+	DISPATCH_TRACE_EVENT_RUNTIME,
+);
+
+typedef struct dispatch_trace_entry_s {
+	uint64_t dte_stamp_delta : 48;
+	uint64_t dte_event : 16;
+	// the serial number of the queue, or the event for
+	// DISPATCH_TRACE_EVENT_RUNTIME
+	uint64_t dte_queue;
+	// the item pushed or popped, the context of callouts, or the pointer
+	// argument of runtime events
+	uint64_t dte_item;
+	// the function called out to, or the value of runtime events
+	uint64_t dte_func;
+} *dispatch_trace_entry_t;
+
+#define DISPATCH_TRACE_CHUNK_HEADER_SIZE	32u
+#define DISPATCH_TRACE_CHUNK_ENTRY_COUNT \
+		((DISPATCH_TRACE_CHUNK_SIZE - DISPATCH_TRACE_CHUNK_HEADER_SIZE) / \
+		sizeof(struct dispatch_trace_entry_s))
+
+typedef struct dispatch_trace_chunk_s {
+	uint64_t volatile dtc_generation;
+	uint64_t dtc_timestamp; // in nanoseconds, see _dispatch_uptime()
+	uint32_t volatile dtc_count;
+	uint32_t dtc_unused;
+	uint64_t dtc_pad;
+	struct dispatch_trace_entry_s dtc_entries[DISPATCH_TRACE_CHUNK_ENTRY_COUNT];
+} *dispatch_trace_chunk_t;
+
+dispatch_static_assert(offsetof(struct dispatch_trace_chunk_s, dtc_entries) ==
+		DISPATCH_TRACE_CHUNK_HEADER_SIZE);
+dispatch_static_assert(sizeof(struct dispatch_trace_chunk_s) <=
+		DISPATCH_TRACE_CHUNK_SIZE);
+
+typedef struct dispatch_trace_dump_header_s {
+	uint64_t dtdh_magic;
+	uint32_t dtdh_version;
+	uint32_t dtdh_chunk_size;
+	uint32_t dtdh_entry_size;
+	uint32_t dtdh_thread_count;
+	uint64_t dtdh_timestamp; // time of the dump, in nanoseconds
+} *dispatch_trace_dump_header_t;
+
+typedef struct dispatch_trace_dump_thread_s {
+	uint64_t dtdt_tid;
+	uint32_t dtdt_chunk_count;
+	uint32_t dtdt_unused;
+} *dispatch_trace_dump_thread_t;
+
+#if DISPATCH_USE_TRACE_BUFFER
+typedef struct dispatch_trace_buffer_s {
+	struct dispatch_trace_chunk_s dtb_chunks[DISPATCH_TRACE_CHUNK_COUNT];
+	struct dispatch_trace_buffer_s *dtb_next;
+	// the tid of the thread recording into this buffer, 0 when the buffer is
+	// free to be adopted by a new thread
+	uint64_t volatile dtb_owner;
+	uint64_t dtb_tid; // the tid of the last owner
+	uint32_t dtb_head;
+} *dispatch_trace_buffer_t;
+
+extern bool _dispatch_trace_buffer_enabled;
+extern __thread dispatch_trace_buffer_t __dispatch_trace_buffer;
+
+void _dispatch_trace_buffer_init(void);
+// returns NULL once the buffer of the thread was unregistered at thread exit
+dispatch_trace_buffer_t _dispatch_trace_buffer_register(void);
+void _dispatch_trace_buffer_unregister(void);
+dispatch_trace_chunk_t _dispatch_trace_buffer_next_chunk(
+		dispatch_trace_buffer_t dtb, uint64_t now);
+
+DISPATCH_ALWAYS_INLINE
+static inline bool
+_dispatch_trace_buffer_recording(void)
+{
+	return __dispatch_trace_buffer || _dispatch_trace_buffer_enabled;
+}
+
+DISPATCH_ALWAYS_INLINE
+static inline void
+_dispatch_trace_buffer_record(dispatch_trace_event_t event, uint64_t queue,
+		const void *item, const void *func)
+{
+	dispatch_trace_buffer_t dtb = __dispatch_trace_buffer;
+	dispatch_trace_chunk_t dtc;
+	dispatch_trace_entry_t dte;
+	uint32_t count;
+	uint64_t now;
+
+	if (likely(!dtb)) {
+		if (likely(!_dispatch_trace_buffer_enabled)) return;
+		dtb = _dispatch_trace_buffer_register();
+		if (unlikely(!dtb)) return;
+	}
+
+	now = _dispatch_time_mach2nano(_dispatch_uptime());
+	dtc = &dtb->dtb_chunks[dtb->dtb_head % DISPATCH_TRACE_CHUNK_COUNT];
+	count = dtc->dtc_count;
+	if (unlikely(count == DISPATCH_TRACE_CHUNK_ENTRY_COUNT ||
+			now - dtc->dtc_timestamp > DISPATCH_TRACE_STAMP_DELTA_MAX)) {
+		dtc = _dispatch_trace_buffer_next_chunk(dtb, now);
+		count = 0;
+	}
+	dte = &dtc->dtc_entries[count];
+	dte->dte_stamp_delta = now - dtc->dtc_timestamp;
+	dte->dte_event = event;
+	dte->dte_queue = queue;
+	dte->dte_item = (uint64_t)(uintptr_t)item;
+	dte->dte_func = (uint64_t)(uintptr_t)func;
+	os_atomic_store2o(dtc, dtc_count, count + 1, release);
+}
+#else
+#define _dispatch_trace_buffer_init()
+#define _dispatch_trace_buffer_unregister()
+#define _dispatch_trace_buffer_recording() false
+#define _dispatch_trace_buffer_record(event, queue, item, func) \
+		do { (void)(event); (void)(queue); (void)(item); (void)(func); } \
+		while (0)
+#endif // DISPATCH_USE_TRACE_BUFFER
+
+#endif // __DISPATCH_TRACE_BUFFER_INTERNAL__
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+
+#
+# Copyright (c) 2019 Apple Inc. All rights reserved.
+#
+# @APPLE_APACHE_LICENSE_HEADER_START@
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# @APPLE_APACHE_LICENSE_HEADER_END@
+#
+
+#
+# Usage: dispatch_trace_convert.py [-p pid] trace-file [output.json]
+#        Converts a dump of the libdispatch trace buffers (see
+#        dispatch_introspection_trace_buffer_dump()) to the Chrome trace event
+#        format, which chrome://tracing and https://ui.perfetto.dev can open.
+#
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = 0x4853415053494444
+VERSION = 1
+
+HEADER = struct.Struct('<QIIIIQ')   # struct dispatch_trace_dump_header_s
+THREAD = struct.Struct('<QII')      # struct dispatch_trace_dump_thread_s
+CHUNK = struct.Struct('<QQII8x')    # struct dispatch_trace_chunk_s header
+ENTRY = struct.Struct('<QQQQ')      # struct dispatch_trace_entry_s
+
+EVENT_PUSH = 1
+EVENT_POP = 2
+EVENT_CALLOUT_ENTRY = 3
+EVENT_CALLOUT_RETURN = 4
+EVENT_RUNTIME = 5
+
+RUNTIME_EVENTS = {
+    1: 'worker_event_delivery',
+    2: 'worker_unpark',
+    3: 'worker_request',
+    4: 'worker_park',
+    10: 'sync_wait',
+    11: 'async_sync_handoff',
+    12: 'sync_sync_handoff',
+    13: 'sync_async_handoff',
+}
+
+
+def parse_chunk(data, tid):
+    gen, base, count = CHUNK.unpack_from(data)[:3]
+    if gen == 0 or count == 0:
+        return
+    for i in range(count):
+        word, queue, item, func = ENTRY.unpack_from(data,
+                CHUNK.size + i * ENTRY.size)
+        stamp = base + (word & ((1 << 48) - 1))
+        yield stamp, word >> 48, queue, item, func
+
+
+def convert(path, pid):
+    with open(path, 'rb') as f:
+        data = f.read()
+    magic, version, chunk_size, entry_size, thread_count, now = \
+            HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION or entry_size != ENTRY.size:
+        raise ValueError('%s: not a libdispatch trace buffer dump' % path)
+
+    events = []
+    offset = HEADER.size
+    for _ in range(thread_count):
+        tid, chunk_count, _ = THREAD.unpack_from(data, offset)
+        offset += THREAD.size
+        records = []
+        for _ in range(chunk_count):
+            records.extend(parse_chunk(data[offset:offset + chunk_size], tid))
+            offset += chunk_size
+        records.sort(key=lambda r: r[0])
+        for stamp, kind, queue, item, func in records:
+            ev = {'pid': pid, 'tid': tid, 'ts': stamp / 1000.0}
+            if kind == EVENT_PUSH or kind == EVENT_POP:
+                ev.update(ph='i', s='t', cat='queue',
+                        name='push' if kind == EVENT_PUSH else 'pop',
+                        args={'queue': queue, 'item': hex(item),
+                              'func': hex(func)})
+            elif kind == EVENT_CALLOUT_ENTRY or kind == EVENT_CALLOUT_RETURN:
+                ev.update(ph='B' if kind == EVENT_CALLOUT_ENTRY else 'E',
+                        cat='callout', name=hex(func),
+                        args={'queue': queue, 'ctxt': hex(item)})
+            elif kind == EVENT_RUNTIME:
+                ev.update(ph='i', s='t', cat='runtime',
+                        name=RUNTIME_EVENTS.get(queue, 'event_%d' % queue),
+                        args={'ptr': hex(item), 'value': func})
+            else:
+                continue
+            events.append(ev)
+    return {'traceEvents': events, 'displayTimeUnit': 'ns',
+            'otherData': {'dump_timestamp_ns': now}}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a libdispatch '
+            'trace buffer dump to the Chrome trace event format.')
+    parser.add_argument('-p', '--pid', type=int, default=0,
+            help='process id to report the events under')
+    parser.add_argument('trace')
+    parser.add_argument('output', nargs='?')
+    args = parser.parse_args()
+
+    trace = convert(args.trace, args.pid)
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()